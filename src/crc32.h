@@ -0,0 +1,12 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include "pico/stdlib.h"
+
+// CRC-32 (IEEE 802.3, as used by zip and gzip)
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len);
+
+#define CRC32_INIT 0xFFFFFFFF
+#define crc32_final(crc) ((crc) ^ 0xFFFFFFFF)
+
+#endif // CRC32_H
@@ -0,0 +1,296 @@
+#include "exfat_dir.h"
+#include "fat_dir.h"
+#include "fat_lfn.h"
+#include "sd_analyzer.h"
+#include <stdio.h>
+#include <string.h>
+
+// Name of the set being assembled, decoded once the checksum passed
+static uint16_t name_units[EXFAT_NAME_UNITS];
+
+static uint16_t read_le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_le64(const uint8_t* p) {
+    return read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+}
+
+void exfat_dir_open(exfat_dir_iter_t* it, exfat_volume_t* vol, uint32_t first_cluster,
+                    bool contiguous, uint64_t data_length) {
+    memset(it, 0, sizeof(*it));
+    it->vol = vol;
+    it->first_cluster = first_cluster;
+    it->cluster = first_cluster;
+    it->contiguous = contiguous;
+
+    if (contiguous) {
+        uint32_t cluster_bytes = exfat_volume_cluster_bytes(vol);
+        it->cluster_limit = (uint32_t)((data_length + cluster_bytes - 1) / cluster_bytes);
+        if (it->cluster_limit == 0) {
+            it->done = true;
+            return;
+        }
+    }
+
+    if (!exfat_volume_is_data_cluster(vol, first_cluster)) {
+        it->done = true;
+        it->error = (first_cluster == 0) ? 0 : -4; // Cluster 0: empty directory
+    }
+}
+
+void exfat_dir_open_entry(exfat_dir_iter_t* it, exfat_volume_t* vol, const exfat_dirent_t* ent) {
+    exfat_dir_open(it, vol, ent->first_cluster,
+                   (ent->stream_flags & EXFAT_STREAM_NO_FAT_CHAIN) != 0, ent->data_length);
+}
+
+// Move to the entry after the one just read
+static void exfat_dir_advance(exfat_dir_iter_t* it) {
+    exfat_volume_t* vol = it->vol;
+
+    it->index++;
+    if (it->index % 16 != 0) {
+        return;
+    }
+
+    it->sector_in_cluster++;
+    if (it->sector_in_cluster < (1u << vol->sectors_per_cluster_shift)) {
+        return;
+    }
+
+    it->sector_in_cluster = 0;
+    it->cluster_index++;
+
+    if (it->contiguous) {
+        it->cluster++;
+        if (it->cluster_index >= it->cluster_limit || !exfat_volume_is_data_cluster(vol, it->cluster)) {
+            it->done = true;
+        }
+        return;
+    }
+
+    int result = exfat_volume_next_cluster(vol, it->cluster, &it->cluster);
+    if (result <= 0) {
+        it->done = true;
+        it->error = result;
+    }
+}
+
+int exfat_dir_next_raw(exfat_dir_iter_t* it, const uint8_t** entry) {
+    if (it->done) {
+        return it->error;
+    }
+
+    uint32_t lba = exfat_volume_cluster_to_lba(it->vol, it->cluster) + it->sector_in_cluster;
+    const uint8_t* sector = exfat_volume_read_dir_sector(it->vol, lba);
+    if (!sector) {
+        it->done = true;
+        it->error = -1;
+        return -1;
+    }
+
+    const uint8_t* e = &sector[(it->index % 16) * 32];
+    if (e[0] == 0x00) {
+        it->done = true; // End of directory marker
+        return 0;
+    }
+
+    exfat_dir_advance(it);
+    *entry = e;
+    return 1;
+}
+
+// Read the rest of the set whose file entry was just returned, leaving the
+// name's code units in name_units. With a query, sets whose stream
+// extension has another name length or hash are passed over without
+// checksumming or copying their name entries. *accepted is set for a valid
+// set that was not passed over; returns 1, 0 at the end, or an error.
+static int exfat_dir_read_set(exfat_dir_iter_t* it, const uint8_t* entry, exfat_dirent_t* ent,
+                              const exfat_name_query_t* query, bool* accepted) {
+    uint32_t secondary_count = entry[1];
+    uint16_t stored_checksum = read_le16(&entry[2]);
+    int result;
+
+    *accepted = false;
+    it->sets_seen++;
+
+    if (secondary_count < 2 || secondary_count > 18) {
+        it->bad_sets++;
+        return 1;
+    }
+
+    // The set checksum covers every entry except its own two bytes
+    uint16_t sum = 0;
+    for (int i = 0; i < 32; i++) {
+        if (i == 2 || i == 3) continue;
+        sum = ((sum & 1) ? 0x8000 : 0) + (sum >> 1) + entry[i];
+    }
+
+    ent->index = it->index - 1;
+    ent->attributes = read_le16(&entry[4]);
+    ent->create_time = read_le32(&entry[8]);
+    ent->modify_time = read_le32(&entry[12]);
+
+    bool valid = true;
+    bool skip = false;
+    uint32_t units = 0;
+    for (uint32_t s = 1; s <= secondary_count; s++) {
+        result = exfat_dir_next_raw(it, &entry);
+        if (result <= 0) {
+            return result;
+        }
+
+        if (skip) {
+            continue;
+        }
+
+        for (int i = 0; i < 32; i++) {
+            sum = ((sum & 1) ? 0x8000 : 0) + (sum >> 1) + entry[i];
+        }
+
+        if (s == 1) {
+            // The stream extension always comes first
+            if (entry[0] != EXFAT_ENTRY_STREAM) {
+                valid = false;
+                continue;
+            }
+            ent->stream_flags = entry[1];
+            ent->name_length = entry[3];
+            ent->name_hash = read_le16(&entry[4]);
+            ent->valid_length = read_le64(&entry[8]);
+            ent->first_cluster = read_le32(&entry[20]);
+            ent->data_length = read_le64(&entry[24]);
+
+            if (query && (ent->name_length != query->length ||
+                          (query->use_hash && ent->name_hash != query->hash))) {
+                skip = true;
+            }
+        } else if (entry[0] == EXFAT_ENTRY_NAME) {
+            for (int i = 0; i < 15 && units < ent->name_length; i++) {
+                name_units[units++] = read_le16(&entry[2 + i * 2]);
+            }
+        } else if (!(entry[0] & 0x80)) {
+            valid = false; // Set cut short by an unused slot
+        }
+    }
+
+    if (skip) {
+        return 1;
+    }
+
+    if (!valid || sum != stored_checksum || ent->name_length == 0 || units < ent->name_length) {
+        it->bad_sets++;
+        return 1;
+    }
+
+    *accepted = true;
+    return 1;
+}
+
+int exfat_dir_next(exfat_dir_iter_t* it, exfat_dirent_t* ent) {
+    const uint8_t* entry;
+    int result;
+
+    while ((result = exfat_dir_next_raw(it, &entry)) > 0) {
+        if (entry[0] != EXFAT_ENTRY_FILE) {
+            continue; // Other primaries, unused slots and stray secondaries
+        }
+
+        bool accepted;
+        result = exfat_dir_read_set(it, entry, ent, NULL, &accepted);
+        if (result <= 0) {
+            return result;
+        }
+
+        if (accepted) {
+            fat_lfn_utf16_to_utf8(name_units, ent->name_length, ent->name, sizeof(ent->name));
+            return 1;
+        }
+    }
+
+    return result;
+}
+
+uint16_t exfat_dir_name_hash(const uint16_t* units, uint32_t count) {
+    uint16_t hash = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        hash = ((hash & 1) ? 0x8000 : 0) + (hash >> 1) + (units[i] & 0xFF);
+        hash = ((hash & 1) ? 0x8000 : 0) + (hash >> 1) + (units[i] >> 8);
+    }
+    return hash;
+}
+
+int exfat_dir_make_query(const exfat_volume_t* vol, const char* name, size_t len,
+                         exfat_name_query_t* query) {
+    int count = fat_lfn_utf8_to_utf16(name, len, query->units, EXFAT_NAME_UNITS);
+    if (count <= 0) {
+        return -7;
+    }
+
+    for (int i = 0; i < count; i++) {
+        query->units[i] = exfat_volume_upcase(vol, query->units[i]);
+    }
+
+    query->length = (uint8_t)count;
+    query->hash = exfat_dir_name_hash(query->units, (uint32_t)count);
+    query->use_hash = vol->upcase_loaded;
+    return 0;
+}
+
+int exfat_dir_find(exfat_dir_iter_t* it, const exfat_name_query_t* query, exfat_dirent_t* ent) {
+    const uint8_t* entry;
+    int result;
+
+    while ((result = exfat_dir_next_raw(it, &entry)) > 0) {
+        if (entry[0] != EXFAT_ENTRY_FILE) {
+            continue;
+        }
+
+        bool accepted;
+        result = exfat_dir_read_set(it, entry, ent, query, &accepted);
+        if (result <= 0) {
+            return result;
+        }
+        if (!accepted) {
+            continue;
+        }
+
+        // A matching hash only narrows the search; names still decide
+        it->names_compared++;
+        uint32_t i = 0;
+        while (i < query->length && exfat_volume_upcase(it->vol, name_units[i]) == query->units[i]) {
+            i++;
+        }
+        if (i == query->length) {
+            fat_lfn_utf16_to_utf8(name_units, ent->name_length, ent->name, sizeof(ent->name));
+            return 1;
+        }
+    }
+
+    return result;
+}
+
+void exfat_dir_print_entry(const exfat_dirent_t* ent) {
+    uint16_t attributes = ent->attributes;
+    bool is_dir = (attributes & FAT_ATTR_DIRECTORY) != 0;
+    char w = (attributes & FAT_ATTR_READ_ONLY) ? '-' : 'w';
+    char x = is_dir ? 'x' : '-';
+
+    printf("  %cr%c%cr%c%cr%c%c %2d", is_dir ? 'd' : '-', w, x, w, x, w, x, 1);
+
+    if (is_dir) {
+        printf(" %10s", "<DIR>");
+    } else {
+        printf(" %10llu", (unsigned long long)ent->data_length);
+    }
+
+    char datetime_str[32];
+    sd_analyzer_format_fat_datetime(ent->modify_time >> 16, ent->modify_time & 0xFFFF,
+                                    datetime_str, sizeof(datetime_str));
+    printf(" %s %s\n", datetime_str, ent->name);
+}
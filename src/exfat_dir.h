@@ -0,0 +1,96 @@
+#ifndef EXFAT_DIR_H
+#define EXFAT_DIR_H
+
+#include "pico/stdlib.h"
+#include "exfat_volume.h"
+
+// Names are up to 255 UTF-16 code units, at most 3 UTF-8 bytes each
+#define EXFAT_NAME_UNITS 255
+#define EXFAT_NAME_MAX   (EXFAT_NAME_UNITS * 3 + 1)
+
+// Directory entry types (InUse bit set)
+#define EXFAT_ENTRY_BITMAP  0x81
+#define EXFAT_ENTRY_UPCASE  0x82
+#define EXFAT_ENTRY_LABEL   0x83
+#define EXFAT_ENTRY_FILE    0x85
+#define EXFAT_ENTRY_GUID    0xA0
+#define EXFAT_ENTRY_STREAM  0xC0
+#define EXFAT_ENTRY_NAME    0xC1
+
+// GeneralSecondaryFlags of the stream extension
+#define EXFAT_STREAM_ALLOCATED   0x01
+#define EXFAT_STREAM_NO_FAT_CHAIN 0x02
+
+// One decoded file entry set: file, stream extension and name entries.
+// Attributes use the FAT_ATTR_* bits; timestamps are FAT date << 16 | time.
+typedef struct {
+    char name[EXFAT_NAME_MAX];
+    uint16_t attributes;
+    uint8_t stream_flags;
+    uint8_t name_length;        // In UTF-16 code units
+    uint16_t name_hash;
+    uint32_t create_time;
+    uint32_t modify_time;
+    uint64_t valid_length;
+    uint64_t data_length;
+    uint32_t first_cluster;
+    uint32_t index;             // Index of the file entry in the directory
+} exfat_dirent_t;
+
+// Streaming iterator over one directory. It holds no sector of its own:
+// reads go through the volume's shared directory sector, so iterators are
+// small enough to be copied and kept on a walk stack.
+typedef struct {
+    exfat_volume_t* vol;
+    uint32_t first_cluster;
+    uint32_t cluster;           // Current cluster
+    uint32_t cluster_index;     // Clusters passed so far
+    uint32_t cluster_limit;     // Contiguous directories: clusters in the run
+    uint32_t sector_in_cluster;
+    uint32_t index;             // Index of the next entry to read
+    bool contiguous;            // NoFatChain: clusters follow each other
+    bool done;
+    int error;
+    uint32_t bad_sets;          // Entry sets skipped for bad checksum or layout
+    uint32_t sets_seen;         // File entry sets reached
+    uint32_t names_compared;    // Sets whose name was assembled and checked
+} exfat_dir_iter_t;
+
+// A name looked up by exfat_dir_find(): up-cased and hashed once, so that
+// sets can be rejected on their stream extension alone
+typedef struct {
+    uint16_t units[EXFAT_NAME_UNITS];   // Up-cased UTF-16
+    uint8_t length;
+    uint16_t hash;
+    bool use_hash;              // Off when the up-case table is not loaded
+} exfat_name_query_t;
+
+// Open a directory. Contiguous directories (NoFatChain) need their data
+// length to know where they end; FAT-chained ones ignore it.
+void exfat_dir_open(exfat_dir_iter_t* it, exfat_volume_t* vol, uint32_t first_cluster,
+                    bool contiguous, uint64_t data_length);
+void exfat_dir_open_entry(exfat_dir_iter_t* it, exfat_volume_t* vol, const exfat_dirent_t* ent);
+
+// Next raw 32-byte entry, valid until the next read through the volume.
+// Returns 1, 0 at the end marker or end of the directory, or an error.
+int exfat_dir_next_raw(exfat_dir_iter_t* it, const uint8_t** entry);
+
+// Next entry set whose checksum and layout are valid
+int exfat_dir_next(exfat_dir_iter_t* it, exfat_dirent_t* ent);
+
+// NameHash of up-cased UTF-16 code units, as stored in the stream extension
+uint16_t exfat_dir_name_hash(const uint16_t* units, uint32_t count);
+
+// Prepare a query from a UTF-8 name. Returns -7 for names that cannot
+// exist on exFAT (empty or longer than 255 code units).
+int exfat_dir_make_query(const exfat_volume_t* vol, const char* name, size_t len,
+                         exfat_name_query_t* query);
+
+// Next entry set whose name matches the query, compared case-insensitively
+// through the up-case table. Returns 1, 0 if there is none, or an error.
+int exfat_dir_find(exfat_dir_iter_t* it, const exfat_name_query_t* query, exfat_dirent_t* ent);
+
+// Print one entry in the same 'ls -l' style as fat_dir_print_entry()
+void exfat_dir_print_entry(const exfat_dirent_t* ent);
+
+#endif // EXFAT_DIR_H
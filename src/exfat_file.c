@@ -0,0 +1,165 @@
+#include "exfat_file.h"
+#include "exfat_path.h"
+#include "fat_dir.h"
+#include "sd_block.h"
+#include <string.h>
+
+// Bounce buffer for reads that start or end inside a sector
+static uint8_t file_sector[512];
+
+int exfat_file_open_entry(exfat_file_t* file, exfat_volume_t* vol, const exfat_dirent_t* ent) {
+    if (ent->attributes & FAT_ATTR_DIRECTORY) {
+        return -6; // Not a regular file
+    }
+
+    memset(file, 0, sizeof(*file));
+    file->vol = vol;
+    file->first_cluster = ent->first_cluster;
+    file->size = ent->data_length;
+    file->valid_length = ent->valid_length < ent->data_length ? ent->valid_length : ent->data_length;
+    file->attributes = ent->attributes;
+    file->contiguous = (ent->stream_flags & EXFAT_STREAM_NO_FAT_CHAIN) != 0;
+    file->chain_cluster = ent->first_cluster;
+
+    if (file->size == 0) {
+        return 0;
+    }
+
+    if (!exfat_volume_is_data_cluster(vol, file->first_cluster)) {
+        return -4;
+    }
+
+    if (file->contiguous) {
+        // The whole file is one extent; check it stays inside the heap
+        uint32_t cluster_bytes = exfat_volume_cluster_bytes(vol);
+        uint64_t clusters = (file->size + cluster_bytes - 1) / cluster_bytes;
+        if (clusters > vol->cluster_count ||
+            !exfat_volume_is_data_cluster(vol, file->first_cluster + (uint32_t)clusters - 1)) {
+            return -4;
+        }
+
+        file->extents[0].first_cluster = file->first_cluster;
+        file->extents[0].cluster_count = (uint32_t)clusters;
+        file->extent_count = 1;
+        file->chain_cluster = 0;
+        file->chain_index = (uint32_t)clusters;
+    }
+
+    return 0;
+}
+
+int exfat_file_open_path(exfat_file_t* file, exfat_volume_t* vol, const char* path) {
+    static exfat_dirent_t ent;
+
+    int result = exfat_path_resolve(vol, path, &ent);
+    if (result != 0) {
+        return result;
+    }
+
+    return exfat_file_open_entry(file, vol, &ent);
+}
+
+// Locate the cached extent holding file cluster index, resolving more of the
+// chain as needed. Returns the slot, or a negative error.
+static int exfat_file_find_extent(exfat_file_t* file, uint32_t index) {
+    for (;;) {
+        for (uint32_t i = 0; i < file->extent_count; i++) {
+            if (index >= file->extent_start[i] &&
+                index < file->extent_start[i] + file->extents[i].cluster_count) {
+                return (int)i;
+            }
+        }
+
+        if (file->contiguous) {
+            return -5; // Past the single extent
+        }
+
+        // Seeking backwards restarts from the head of the chain
+        if (file->extent_count > 0 && index < file->extent_start[0]) {
+            file->chain_cluster = file->first_cluster;
+            file->chain_index = 0;
+        }
+
+        if (file->chain_cluster == 0) {
+            return -5; // Chain shorter than the file size
+        }
+
+        // Refill the window with the extents that follow
+        file->extent_count = 0;
+        while (file->extent_count < EXFAT_FILE_EXTENT_CACHE && file->chain_cluster != 0) {
+            fat_extent_t* extent = &file->extents[file->extent_count];
+            int result = exfat_volume_next_extent(file->vol, &file->chain_cluster, extent);
+            if (result < 0) {
+                file->chain_cluster = 0;
+                return result;
+            }
+
+            file->extent_start[file->extent_count] = file->chain_index;
+            file->chain_index += extent->cluster_count;
+            file->extent_count++;
+
+            if (file->chain_index > index) {
+                break; // Target resolved; leave the rest of the chain for later
+            }
+        }
+    }
+}
+
+int32_t exfat_file_read(exfat_file_t* file, uint64_t offset, uint8_t* buffer, uint32_t length) {
+    exfat_volume_t* vol = file->vol;
+    uint32_t cluster_bytes = exfat_volume_cluster_bytes(vol);
+    uint32_t done = 0;
+
+    if (offset >= file->size) {
+        return 0;
+    }
+    if (length > file->size - offset) {
+        length = (uint32_t)(file->size - offset);
+    }
+
+    while (done < length) {
+        uint64_t pos = offset + done;
+        uint32_t want = length - done;
+
+        // Space preallocated past ValidDataLength has never been written
+        if (pos >= file->valid_length) {
+            memset(buffer + done, 0, want);
+            done += want;
+            break;
+        }
+        if (want > file->valid_length - pos) {
+            want = (uint32_t)(file->valid_length - pos);
+        }
+
+        int slot = exfat_file_find_extent(file, (uint32_t)(pos / cluster_bytes));
+        if (slot < 0) {
+            return slot;
+        }
+
+        const fat_extent_t* extent = &file->extents[slot];
+        uint64_t extent_offset = pos - (uint64_t)file->extent_start[slot] * cluster_bytes;
+        uint64_t extent_left = (uint64_t)extent->cluster_count * cluster_bytes - extent_offset;
+        uint32_t lba = exfat_volume_cluster_to_lba(vol, extent->first_cluster) + (uint32_t)(extent_offset / 512);
+        uint32_t in_sector = (uint32_t)(extent_offset % 512);
+        if (want > extent_left) want = (uint32_t)extent_left;
+
+        if (in_sector == 0 && want >= 512) {
+            // Whole sectors of the extent go straight into the caller's buffer
+            uint32_t sectors = want / 512;
+            if (sd_read_blocks(lba, sectors, buffer + done) != 0) {
+                return -1;
+            }
+            done += sectors * 512;
+        } else {
+            uint32_t chunk = 512 - in_sector;
+            if (chunk > want) chunk = want;
+            if (sd_read_block(lba, file_sector) != 0) {
+                return -1;
+            }
+            memcpy(buffer + done, file_sector + in_sector, chunk);
+            done += chunk;
+        }
+    }
+
+    return (int32_t)done;
+}
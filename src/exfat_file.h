@@ -0,0 +1,34 @@
+#ifndef EXFAT_FILE_H
+#define EXFAT_FILE_H
+
+#include "pico/stdlib.h"
+#include "exfat_volume.h"
+#include "exfat_dir.h"
+
+// Extents of a chained file kept resolved at once
+#define EXFAT_FILE_EXTENT_CACHE 8
+
+// Open file on an exFAT volume. A file flagged NoFatChain is one extent
+// from open onwards and never touches the FAT; other files resolve their
+// chain lazily into a window of extents, as fat_file_t does.
+typedef struct {
+    exfat_volume_t* vol;
+    uint32_t first_cluster;
+    uint64_t size;              // DataLength
+    uint64_t valid_length;      // Bytes past this read as zero
+    uint16_t attributes;
+    bool contiguous;
+    uint32_t extent_count;
+    uint32_t extent_start[EXFAT_FILE_EXTENT_CACHE];    // File cluster index of each extent
+    fat_extent_t extents[EXFAT_FILE_EXTENT_CACHE];
+    uint32_t chain_cluster;     // Volume cluster after the cached extents (0 = end)
+    uint32_t chain_index;       // File cluster index of chain_cluster
+} exfat_file_t;
+
+int exfat_file_open_entry(exfat_file_t* file, exfat_volume_t* vol, const exfat_dirent_t* ent);
+int exfat_file_open_path(exfat_file_t* file, exfat_volume_t* vol, const char* path);
+
+// Read up to length bytes at offset; returns bytes read or a negative error
+int32_t exfat_file_read(exfat_file_t* file, uint64_t offset, uint8_t* buffer, uint32_t length);
+
+#endif // EXFAT_FILE_H
@@ -0,0 +1,89 @@
+#include "exfat_path.h"
+#include "fat_dir.h"
+#include <stdio.h>
+#include <string.h>
+
+static exfat_name_query_t path_query;
+static uint32_t stat_lookups;
+static uint32_t stat_sets;
+static uint32_t stat_compared;
+
+void exfat_path_reset_stats(void) {
+    stat_lookups = 0;
+    stat_sets = 0;
+    stat_compared = 0;
+}
+
+void exfat_path_print_stats(void) {
+    printf("Name lookups: %u components, %u entry sets reached, %u names compared\n",
+           stat_lookups, stat_sets, stat_compared);
+}
+
+int exfat_path_resolve(exfat_volume_t* vol, const char* path, exfat_dirent_t* ent) {
+    exfat_dir_iter_t it;
+    bool at_root = true;
+
+    memset(ent, 0, sizeof(*ent));
+    strcpy(ent->name, "/");
+    ent->attributes = FAT_ATTR_DIRECTORY;
+    ent->first_cluster = vol->root_cluster;
+
+    while (*path) {
+        while (*path == '/') path++;
+        if (*path == 0) break;
+
+        const char* end = path;
+        while (*end && *end != '/') end++;
+
+        if (!(ent->attributes & FAT_ATTR_DIRECTORY)) {
+            return -6; // Path continues below a file
+        }
+
+        int result = exfat_dir_make_query(vol, path, end - path, &path_query);
+        if (result != 0) {
+            return result;
+        }
+
+        // The root has no entry set of its own and is always FAT-chained
+        if (at_root) {
+            exfat_dir_open(&it, vol, vol->root_cluster, false, 0);
+        } else {
+            exfat_dir_open_entry(&it, vol, ent);
+        }
+
+        result = exfat_dir_find(&it, &path_query, ent);
+        stat_lookups++;
+        stat_sets += it.sets_seen;
+        stat_compared += it.names_compared;
+        if (result <= 0) {
+            return result < 0 ? result : -7; // Not found
+        }
+
+        at_root = false;
+        path = end;
+    }
+
+    return 0;
+}
+
+int exfat_path_print(exfat_volume_t* vol, const char* path) {
+    static exfat_dirent_t ent;
+
+    int result = exfat_path_resolve(vol, path, &ent);
+    switch (result) {
+        case 0:
+            exfat_dir_print_entry(&ent);
+            break;
+        case -7:
+            printf("  %s: not found\n", path);
+            break;
+        case -6:
+            printf("  %s: not a directory\n", path);
+            break;
+        default:
+            printf("  %s: lookup failed (error %d)\n", path, result);
+            break;
+    }
+
+    return result;
+}
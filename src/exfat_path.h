@@ -0,0 +1,22 @@
+#ifndef EXFAT_PATH_H
+#define EXFAT_PATH_H
+
+#include "pico/stdlib.h"
+#include "exfat_volume.h"
+#include "exfat_dir.h"
+
+// Resolve an absolute path to its entry set. Each component is up-cased and
+// hashed once; only sets with a matching NameHash have their names read.
+// The root resolves to a directory entry for the root cluster. Returns 0,
+// -7 if a component does not exist, -6 if the path continues below a file,
+// or a read error.
+int exfat_path_resolve(exfat_volume_t* vol, const char* path, exfat_dirent_t* ent);
+
+// Entry sets reached and names compared by lookups since the last reset
+void exfat_path_reset_stats(void);
+void exfat_path_print_stats(void);
+
+// Print one path in 'ls -l' style, or why it could not be resolved
+int exfat_path_print(exfat_volume_t* vol, const char* path);
+
+#endif // EXFAT_PATH_H
@@ -0,0 +1,189 @@
+#include "exfat_space.h"
+#include "partition_display.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <string.h>
+
+// Word-aligned chunk buffer for streaming the bitmap
+static uint32_t bitmap_buf[EXFAT_SPACE_CHUNK_SECTORS * 512 / 4];
+
+typedef struct {
+    uint32_t used;
+    uint32_t next;              // Cluster index (from 0) of the next bit
+    uint32_t run;
+    uint32_t run_start;
+    uint32_t best;
+    uint32_t best_start;
+} exfat_space_scan_t;
+
+// Set bits of a word without a popcount instruction: pairs, nibbles, then
+// one multiply gathers the byte sums into the top byte
+static inline uint32_t popcount32(uint32_t v) {
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    v = (v + (v >> 4)) & 0x0F0F0F0F;
+    return (v * 0x01010101) >> 24;
+}
+
+static inline void scan_close_run(exfat_space_scan_t* s) {
+    if (s->run > s->best) {
+        s->best = s->run;
+        s->best_start = s->run_start;
+    }
+    s->run = 0;
+}
+
+// Free runs of a word with both used and free bits. Bit 0 is the lowest
+// cluster: trailing zeros extend the open run, leading zeros start the
+// next one, and the longest run strictly inside the word is found by
+// shrinking every run of ones in ~w by one bit per step.
+static void scan_mixed_word(exfat_space_scan_t* s, uint32_t w) {
+    uint32_t low = __builtin_ctz(w);
+    uint32_t high = __builtin_clz(w);
+
+    if (low > 0) {
+        if (s->run == 0) s->run_start = s->next;
+        s->run += low;
+    }
+    scan_close_run(s);
+
+    uint32_t inner = ~w & ~((1u << low) - 1) & (high ? ~(0xFFFFFFFFu << (32 - high)) : 0xFFFFFFFF);
+    if (inner) {
+        uint32_t x = inner;
+        uint32_t starts = x;
+        uint32_t length = 0;
+        while (x) {
+            starts = x;
+            x &= x >> 1;
+            length++;
+        }
+        if (length > s->best) {
+            s->best = length;
+            s->best_start = s->next + __builtin_ctz(starts);
+        }
+    }
+
+    if (high > 0) {
+        s->run = high;
+        s->run_start = s->next + 32 - high;
+    }
+}
+
+static void scan_words(exfat_space_scan_t* s, const uint32_t* words, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t w = words[i];
+
+        // Empty and full words are the common case in a bitmap
+        if (w == 0) {
+            if (s->run == 0) s->run_start = s->next;
+            s->run += 32;
+        } else if (w == 0xFFFFFFFF) {
+            s->used += 32;
+            scan_close_run(s);
+        } else {
+            s->used += popcount32(w);
+            scan_mixed_word(s, w);
+        }
+        s->next += 32;
+    }
+}
+
+int exfat_space_count(exfat_volume_t* vol, fat_space_t* space) {
+    exfat_space_scan_t scan = {0};
+    uint32_t sectors_per_cluster = 1u << vol->sectors_per_cluster_shift;
+    uint32_t bitmap_bytes = (vol->cluster_count + 7) / 8;
+    uint32_t bitmap_sectors = (bitmap_bytes + 511) / 512;
+    uint32_t cluster = vol->bitmap_cluster;
+    uint32_t sector_in_cluster = 0;
+    uint32_t sector = 0;
+    uint32_t padding = 0;
+
+    memset(space, 0, sizeof(*space));
+
+    if (vol->bitmap_length < bitmap_bytes) {
+        return -2; // Bitmap too short for the cluster count
+    }
+
+    uint64_t start_us = time_us_64();
+
+    while (sector < bitmap_sectors) {
+        if (!exfat_volume_is_data_cluster(vol, cluster)) {
+            return -4;
+        }
+
+        // Read up to a chunk without leaving the current cluster
+        uint32_t chunk = bitmap_sectors - sector;
+        if (chunk > EXFAT_SPACE_CHUNK_SECTORS) chunk = EXFAT_SPACE_CHUNK_SECTORS;
+        if (chunk > sectors_per_cluster - sector_in_cluster) chunk = sectors_per_cluster - sector_in_cluster;
+
+        uint32_t lba = exfat_volume_cluster_to_lba(vol, cluster) + sector_in_cluster;
+        if (sd_read_blocks(lba, chunk, (uint8_t*)bitmap_buf) != 0) {
+            return -1;
+        }
+
+        uint32_t words = chunk * 128;
+        uint32_t bits_left = vol->cluster_count - sector * 4096;
+        if (words * 32 > bits_left) {
+            // Bits past the last cluster count as used so they end any run
+            words = (bits_left + 31) / 32;
+            if (bits_left % 32) {
+                bitmap_buf[words - 1] |= 0xFFFFFFFF << (bits_left % 32);
+                padding = 32 - bits_left % 32;
+            }
+        }
+
+        scan_words(&scan, bitmap_buf, words);
+        sector += chunk;
+        sector_in_cluster += chunk;
+
+        if (sector_in_cluster == sectors_per_cluster && sector < bitmap_sectors) {
+            sector_in_cluster = 0;
+            if (exfat_volume_next_cluster(vol, cluster, &cluster) <= 0) {
+                return -4;
+            }
+        }
+    }
+    scan_close_run(&scan);
+    scan.used -= padding;
+
+    uint32_t cluster_bytes = exfat_volume_cluster_bytes(vol);
+    space->total_clusters = vol->cluster_count;
+    space->cluster_bytes = cluster_bytes;
+    space->free_clusters = vol->cluster_count - scan.used;
+    space->largest_free_run = scan.best;
+    space->largest_free_start = scan.best_start + 2;
+    space->used_bytes = (uint64_t)scan.used * cluster_bytes;
+    space->free_bytes = (uint64_t)space->free_clusters * cluster_bytes;
+    space->scan_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+
+    return 0;
+}
+
+void exfat_space_print(const exfat_volume_t* vol, const fat_space_t* space) {
+    char used_str[32];
+    char free_str[32];
+    char run_str[32];
+
+    partition_display_format_size(space->used_bytes, used_str, sizeof(used_str));
+    partition_display_format_size(space->free_bytes, free_str, sizeof(free_str));
+    partition_display_format_size((uint64_t)space->largest_free_run * space->cluster_bytes, run_str, sizeof(run_str));
+
+    uint32_t used_clusters = space->total_clusters - space->free_clusters;
+    uint32_t percent = space->total_clusters ? (uint32_t)((uint64_t)used_clusters * 100 / space->total_clusters) : 0;
+
+    printf("\n  === Free space (allocation bitmap) ===\n");
+    printf("  Clusters: %u total, %u free (%.1f%%)\n",
+           space->total_clusters, space->free_clusters,
+           space->total_clusters ? space->free_clusters * 100.0 / space->total_clusters : 0.0);
+    printf("  Used: %s, Free: %s\n", used_str, free_str);
+    printf("  Largest free run: %u clusters (%s) at cluster %u\n",
+           space->largest_free_run, run_str, space->largest_free_start);
+    printf("  Bitmap scanned in %u ms\n", space->scan_ms);
+
+    // The boot sector figure is only a hint maintained by the writer, and
+    // writers round it differently
+    if (vol->percent_in_use <= 100 &&
+        (vol->percent_in_use > percent + 1 || vol->percent_in_use + 1u < percent)) {
+        printf("  Boot sector says %u%% in use, bitmap gives %u%%\n", vol->percent_in_use, percent);
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef EXFAT_SPACE_H
+#define EXFAT_SPACE_H
+
+#include "pico/stdlib.h"
+#include "exfat_volume.h"
+#include "fat_space.h"
+
+// Bitmap sectors fetched per multi-block read (8 KB = 65536 clusters)
+#define EXFAT_SPACE_CHUNK_SECTORS 16
+
+// Count used and free clusters from the allocation bitmap in one pass.
+// The FAT is not read; bad clusters are only marked there, so the result
+// counts them as used.
+int exfat_space_count(exfat_volume_t* vol, fat_space_t* space);
+void exfat_space_print(const exfat_volume_t* vol, const fat_space_t* space);
+
+#endif // EXFAT_SPACE_H
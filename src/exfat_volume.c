@@ -0,0 +1,394 @@
+#include "exfat_volume.h"
+#include "exfat_dir.h"
+#include "fat_lfn.h"
+#include "partition_display.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <string.h>
+
+// Main or backup boot region, checked as a whole
+static uint8_t boot_region[EXFAT_BOOT_REGION_SECTORS * 512];
+
+static uint16_t read_le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_le64(const uint8_t* p) {
+    return read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+}
+
+uint32_t exfat_checksum_add(uint32_t sum, uint8_t byte) {
+    return ((sum & 1) ? 0x80000000 : 0) + (sum >> 1) + byte;
+}
+
+// Validate the boot region in boot_region: signature, name, the
+// must-be-zero legacy BPB and the checksum repeated over sector 11
+static bool exfat_boot_region_valid(void) {
+    const uint8_t* boot = boot_region;
+
+    if (boot[510] != 0x55 || boot[511] != 0xAA || memcmp(&boot[3], "EXFAT   ", 8) != 0) {
+        return false;
+    }
+
+    for (int i = 11; i < 64; i++) {
+        if (boot[i] != 0) {
+            return false;
+        }
+    }
+
+    // VolumeFlags and PercentInUse change at runtime and are excluded
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < 11 * 512; i++) {
+        if (i == 106 || i == 107 || i == 112) {
+            continue;
+        }
+        sum = exfat_checksum_add(sum, boot_region[i]);
+    }
+
+    const uint8_t* checksums = &boot_region[11 * 512];
+    for (int i = 0; i < 512; i += 4) {
+        if (read_le32(&checksums[i]) != sum) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Checksum the up-case table by streaming its cluster chain, keeping the
+// mappings that change a character. The table is compressed: 0xFFFF
+// followed by a count skips that many identity mappings.
+static bool exfat_upcase_load(exfat_volume_t* vol) {
+    uint32_t cluster = vol->upcase_cluster;
+    uint64_t left = vol->upcase_length;
+    uint32_t sectors_per_cluster = 1u << vol->sectors_per_cluster_shift;
+    uint32_t sum = 0;
+    uint32_t index = 0;
+    bool skip_count = false;
+    bool overflow = false;
+
+    vol->upcase_count = 0;
+
+    while (left > 0) {
+        if (!exfat_volume_is_data_cluster(vol, cluster)) {
+            return false;
+        }
+
+        uint32_t lba = exfat_volume_cluster_to_lba(vol, cluster);
+        for (uint32_t s = 0; s < sectors_per_cluster && left > 0; s++) {
+            const uint8_t* sector = exfat_volume_read_dir_sector(vol, lba + s);
+            if (!sector) {
+                return false;
+            }
+
+            uint32_t n = left < 512 ? (uint32_t)left : 512;
+            for (uint32_t i = 0; i < n; i++) {
+                sum = exfat_checksum_add(sum, sector[i]);
+            }
+            left -= n;
+
+            // The table length is even, so units never straddle sectors
+            for (uint32_t i = 0; i + 1 < n; i += 2) {
+                uint16_t unit = read_le16(&sector[i]);
+                if (skip_count) {
+                    index += unit;
+                    skip_count = false;
+                } else if (unit == 0xFFFF) {
+                    skip_count = true;
+                } else {
+                    if (unit != index && index < 0x10000) {
+                        if (vol->upcase_count < EXFAT_UPCASE_MAP_MAX) {
+                            vol->upcase_from[vol->upcase_count] = (uint16_t)index;
+                            vol->upcase_to[vol->upcase_count] = unit;
+                            vol->upcase_count++;
+                        } else {
+                            overflow = true;
+                        }
+                    }
+                    index++;
+                }
+            }
+        }
+
+        if (left > 0 && exfat_volume_next_cluster(vol, cluster, &cluster) <= 0) {
+            return false;
+        }
+    }
+
+    if (sum != vol->upcase_checksum) {
+        return false;
+    }
+
+    vol->upcase_loaded = !overflow;
+    return true;
+}
+
+uint16_t exfat_volume_upcase(const exfat_volume_t* vol, uint16_t unit) {
+    if (!vol->upcase_loaded) {
+        return (unit >= 'a' && unit <= 'z') ? unit - 32 : unit;
+    }
+
+    uint32_t low = 0;
+    uint32_t high = vol->upcase_count;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        if (vol->upcase_from[mid] < unit) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low < vol->upcase_count && vol->upcase_from[low] == unit) {
+        return vol->upcase_to[low];
+    }
+    return unit;
+}
+
+// Pick up the allocation bitmap, up-case table and label from the root
+static int exfat_scan_root(exfat_volume_t* vol) {
+    exfat_dir_iter_t it;
+    const uint8_t* entry;
+    uint32_t active_fat = vol->volume_flags & EXFAT_FLAG_ACTIVE_FAT;
+    int result;
+
+    exfat_dir_open(&it, vol, vol->root_cluster, false, 0);
+
+    while ((result = exfat_dir_next_raw(&it, &entry)) > 0) {
+        switch (entry[0]) {
+            case EXFAT_ENTRY_BITMAP:
+                // TexFAT volumes keep one bitmap per FAT; bit 0 says which
+                if ((entry[1] & 1) == active_fat) {
+                    vol->bitmap_cluster = read_le32(&entry[20]);
+                    vol->bitmap_length = read_le64(&entry[24]);
+                }
+                break;
+
+            case EXFAT_ENTRY_UPCASE:
+                vol->upcase_checksum = read_le32(&entry[4]);
+                vol->upcase_cluster = read_le32(&entry[20]);
+                vol->upcase_length = read_le64(&entry[24]);
+                break;
+
+            case EXFAT_ENTRY_LABEL: {
+                uint16_t units[11];
+                uint32_t count = entry[1] <= 11 ? entry[1] : 11;
+                for (uint32_t i = 0; i < count; i++) {
+                    units[i] = read_le16(&entry[2 + i * 2]);
+                }
+                fat_lfn_utf16_to_utf8(units, count, vol->label, sizeof(vol->label));
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    if (result < 0) {
+        return result;
+    }
+
+    // Both are mandatory; without the bitmap nothing is known about space
+    if (vol->bitmap_cluster == 0 || vol->upcase_cluster == 0) {
+        return -2;
+    }
+
+    vol->upcase_valid = exfat_upcase_load(vol);
+    return 0;
+}
+
+int exfat_volume_mount(exfat_volume_t* vol, uint32_t start_lba) {
+    memset(vol, 0, sizeof(*vol));
+    vol->dir_sector_lba = UINT32_MAX;
+
+    // Fall back to the backup region when the main one fails its checks
+    bool valid = false;
+    for (int region = 0; region < 2 && !valid; region++) {
+        uint32_t lba = start_lba + region * EXFAT_BOOT_REGION_SECTORS;
+        if (sd_read_blocks(lba, EXFAT_BOOT_REGION_SECTORS, boot_region) != 0) {
+            return -1;
+        }
+        valid = exfat_boot_region_valid();
+        vol->backup_boot_used = (region == 1);
+    }
+
+    if (!valid) {
+        return -2; // Neither boot region is intact
+    }
+
+    const uint8_t* boot = boot_region;
+    uint8_t bytes_per_sector_shift = boot[108];
+
+    vol->start_lba = start_lba;
+    vol->volume_length = read_le64(&boot[72]);
+    vol->fat_lba = start_lba + read_le32(&boot[80]);
+    vol->fat_length = read_le32(&boot[84]);
+    vol->cluster_heap_lba = start_lba + read_le32(&boot[88]);
+    vol->cluster_count = read_le32(&boot[92]);
+    vol->root_cluster = read_le32(&boot[96]);
+    vol->serial = read_le32(&boot[100]);
+    vol->revision = read_le16(&boot[104]);
+    vol->volume_flags = read_le16(&boot[106]);
+    vol->sectors_per_cluster_shift = boot[109];
+    vol->num_fats = boot[110];
+    vol->percent_in_use = boot[112];
+
+    // The SD driver only transfers 512-byte blocks
+    if (bytes_per_sector_shift != 9 || vol->sectors_per_cluster_shift > 16 ||
+        vol->num_fats == 0 || vol->num_fats > 2 || vol->fat_length == 0 ||
+        (uint64_t)vol->fat_length * 128 < (uint64_t)vol->cluster_count + 2) {
+        return -3; // Unsupported or corrupt geometry
+    }
+
+    // TexFAT: the second FAT may be the active one
+    if ((vol->volume_flags & EXFAT_FLAG_ACTIVE_FAT) && vol->num_fats == 2) {
+        vol->fat_lba += vol->fat_length;
+    }
+
+    if (!exfat_volume_is_data_cluster(vol, vol->root_cluster)) {
+        return -3;
+    }
+
+    return exfat_scan_root(vol);
+}
+
+void exfat_volume_print_info(const exfat_volume_t* vol) {
+    char size_str[32];
+    char cluster_str[32];
+
+    partition_display_format_size(vol->volume_length * 512, size_str, sizeof(size_str));
+    partition_display_format_size(exfat_volume_cluster_bytes(vol), cluster_str, sizeof(cluster_str));
+
+    printf("\n  === exFAT volume ===\n");
+    if (vol->label[0]) {
+        printf("  Label: %s\n", vol->label);
+    }
+    printf("  Serial: %04X-%04X, revision %u.%02u\n",
+           vol->serial >> 16, vol->serial & 0xFFFF, vol->revision >> 8, vol->revision & 0xFF);
+    printf("  Size: %s, %u clusters of %s\n", size_str, vol->cluster_count, cluster_str);
+    printf("  FAT at LBA %u (%u sectors, %u FAT%s), cluster heap at LBA %u\n",
+           vol->fat_lba, vol->fat_length, vol->num_fats, vol->num_fats > 1 ? "s" : "",
+           vol->cluster_heap_lba);
+    printf("  Root directory at cluster %u\n", vol->root_cluster);
+    printf("  Allocation bitmap at cluster %u (%llu bytes)\n",
+           vol->bitmap_cluster, (unsigned long long)vol->bitmap_length);
+    printf("  Up-case table at cluster %u (%llu bytes), checksum %s\n",
+           vol->upcase_cluster, (unsigned long long)vol->upcase_length,
+           vol->upcase_valid ? "OK" : "MISMATCH");
+    if (vol->upcase_valid) {
+        printf("  Up-case mappings: %u%s\n", vol->upcase_count,
+               vol->upcase_loaded ? "" : " (too many to keep, using ASCII rules)");
+    }
+
+    if (vol->percent_in_use <= 100) {
+        printf("  In use (boot sector): %u%%\n", vol->percent_in_use);
+    }
+    if (vol->volume_flags & EXFAT_FLAG_VOLUME_DIRTY) {
+        printf("  Volume is marked dirty (not cleanly unmounted)\n");
+    }
+    if (vol->volume_flags & EXFAT_FLAG_MEDIA_FAILURE) {
+        printf("  Volume reports media failures\n");
+    }
+    if (vol->backup_boot_used) {
+        printf("  WARNING: main boot region is corrupt, using the backup\n");
+    }
+}
+
+uint32_t exfat_volume_cluster_to_lba(const exfat_volume_t* vol, uint32_t cluster) {
+    return vol->cluster_heap_lba + ((cluster - 2) << vol->sectors_per_cluster_shift);
+}
+
+uint32_t exfat_volume_cluster_bytes(const exfat_volume_t* vol) {
+    return 512u << vol->sectors_per_cluster_shift;
+}
+
+bool exfat_volume_is_data_cluster(const exfat_volume_t* vol, uint32_t cluster) {
+    return cluster >= 2 && cluster < vol->cluster_count + 2;
+}
+
+int exfat_volume_get_entry(exfat_volume_t* vol, uint32_t cluster, uint32_t* value) {
+    if (cluster >= vol->cluster_count + 2) {
+        return -2; // Outside the FAT
+    }
+
+    uint32_t offset = cluster * 4;
+    const uint8_t* sector = fat_cache_get(&vol->fat_cache, vol->fat_lba, vol->fat_length, offset / 512);
+    if (!sector) {
+        return -1;
+    }
+
+    *value = read_le32(sector + (offset % 512));
+    return 0;
+}
+
+int exfat_volume_next_cluster(exfat_volume_t* vol, uint32_t cluster, uint32_t* next) {
+    uint32_t value;
+    int result = exfat_volume_get_entry(vol, cluster, &value);
+    if (result != 0) {
+        return result;
+    }
+
+    if (value >= 0xFFFFFFF8) {
+        return 0;
+    }
+
+    if (!exfat_volume_is_data_cluster(vol, value)) {
+        return -4; // Free, bad or out-of-range link inside a chain
+    }
+
+    *next = value;
+    return 1;
+}
+
+int exfat_volume_next_extent(exfat_volume_t* vol, uint32_t* cluster, fat_extent_t* extent) {
+    uint32_t current = *cluster;
+
+    if (current == 0) {
+        return 0;
+    }
+
+    if (!exfat_volume_is_data_cluster(vol, current)) {
+        return -4;
+    }
+
+    extent->first_cluster = current;
+    extent->cluster_count = 1;
+
+    for (;;) {
+        uint32_t next;
+        int result = exfat_volume_next_cluster(vol, current, &next);
+        if (result < 0) {
+            return result;
+        }
+
+        if (result == 0) {
+            *cluster = 0;
+            return 1;
+        }
+
+        if (next != current + 1) {
+            *cluster = next;
+            return 1;
+        }
+
+        current = next;
+        extent->cluster_count++;
+    }
+}
+
+const uint8_t* exfat_volume_read_dir_sector(exfat_volume_t* vol, uint32_t lba) {
+    if (vol->dir_sector_lba != lba) {
+        vol->dir_sector_lba = UINT32_MAX;
+        if (sd_read_block(lba, vol->dir_sector) != 0) {
+            return NULL;
+        }
+        vol->dir_sector_lba = lba;
+    }
+
+    return vol->dir_sector;
+}
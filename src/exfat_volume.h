@@ -0,0 +1,76 @@
+#ifndef EXFAT_VOLUME_H
+#define EXFAT_VOLUME_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+
+// Sectors in each boot region: boot, 8 extended, OEM, reserved, checksum
+#define EXFAT_BOOT_REGION_SECTORS 12
+
+// Volume label is at most 11 UTF-16 code units
+#define EXFAT_LABEL_MAX 48
+
+// Up-case mappings kept in memory: only characters the table changes.
+// The standard table has about a thousand.
+#define EXFAT_UPCASE_MAP_MAX 1536
+
+// VolumeFlags bits
+#define EXFAT_FLAG_ACTIVE_FAT    0x0001
+#define EXFAT_FLAG_VOLUME_DIRTY  0x0002
+#define EXFAT_FLAG_MEDIA_FAILURE 0x0004
+
+// Geometry and metadata of a mounted exFAT volume
+typedef struct {
+    uint32_t start_lba;
+    uint64_t volume_length;     // In sectors
+    uint32_t fat_lba;           // Active FAT
+    uint32_t fat_length;        // Sectors per FAT
+    uint32_t cluster_heap_lba;  // LBA of cluster 2
+    uint32_t cluster_count;
+    uint32_t root_cluster;
+    uint32_t serial;
+    uint16_t revision;          // Major in the high byte
+    uint16_t volume_flags;
+    uint8_t sectors_per_cluster_shift;
+    uint8_t num_fats;
+    uint8_t percent_in_use;     // 0xFF = not available
+    bool backup_boot_used;      // Main boot region failed its checks
+    uint32_t bitmap_cluster;    // Allocation bitmap of the active FAT
+    uint64_t bitmap_length;
+    uint32_t upcase_cluster;
+    uint64_t upcase_length;
+    uint32_t upcase_checksum;
+    bool upcase_valid;          // Table matches its checksum
+    bool upcase_loaded;         // Valid and every mapping fitted in upcase_from/to
+    uint16_t upcase_count;
+    uint16_t upcase_from[EXFAT_UPCASE_MAP_MAX];     // Ascending
+    uint16_t upcase_to[EXFAT_UPCASE_MAP_MAX];
+    char label[EXFAT_LABEL_MAX];
+    fat_cache_t fat_cache;
+    uint32_t dir_sector_lba;    // Directory sector held in dir_sector
+    uint8_t dir_sector[512];
+} exfat_volume_t;
+
+int exfat_volume_mount(exfat_volume_t* vol, uint32_t start_lba);
+void exfat_volume_print_info(const exfat_volume_t* vol);
+
+// Checksum used by the boot region and up-case table: rotate right, add byte
+uint32_t exfat_checksum_add(uint32_t sum, uint8_t byte);
+
+// Up-case one UTF-16 code unit with the volume's table, or ASCII rules
+// when the table could not be loaded
+uint16_t exfat_volume_upcase(const exfat_volume_t* vol, uint16_t unit);
+
+uint32_t exfat_volume_cluster_to_lba(const exfat_volume_t* vol, uint32_t cluster);
+uint32_t exfat_volume_cluster_bytes(const exfat_volume_t* vol);
+bool exfat_volume_is_data_cluster(const exfat_volume_t* vol, uint32_t cluster);
+
+// FAT access; same return convention as fat_volume_next_cluster()
+int exfat_volume_get_entry(exfat_volume_t* vol, uint32_t cluster, uint32_t* value);
+int exfat_volume_next_cluster(exfat_volume_t* vol, uint32_t cluster, uint32_t* next);
+int exfat_volume_next_extent(exfat_volume_t* vol, uint32_t* cluster, fat_extent_t* extent);
+
+// Shared single-sector buffer for directory reads, reloaded only on a miss
+const uint8_t* exfat_volume_read_dir_sector(exfat_volume_t* vol, uint32_t lba);
+
+#endif // EXFAT_VOLUME_H
@@ -0,0 +1,142 @@
+#include "exfat_walk.h"
+#include "fat_dir.h"
+#include <stdio.h>
+#include <string.h>
+
+// Walk state kept off the stack
+static exfat_walk_frame_t walk_stack[EXFAT_WALK_MAX_DEPTH];
+static char walk_path[EXFAT_WALK_PATH_MAX];
+static exfat_dirent_t walk_entry;
+
+// Report every entry of the directory whose iterator starts at it
+static int exfat_walk_list(const exfat_dir_iter_t* start, uint32_t depth,
+                           const exfat_walk_visitor_t* visitor, void* ctx) {
+    exfat_dir_iter_t it = *start;
+    int result;
+
+    if (visitor->enter_dir) visitor->enter_dir(walk_path, depth, ctx);
+
+    while ((result = exfat_dir_next(&it, &walk_entry)) > 0) {
+        if (visitor->entry) visitor->entry(walk_path, &walk_entry, ctx);
+    }
+
+    if (visitor->dir_done) visitor->dir_done(walk_path, ctx);
+
+    if (it.bad_sets > 0) {
+        printf("  %u damaged entry sets skipped in %s\n", it.bad_sets, walk_path);
+    }
+    return result;
+}
+
+int exfat_walk(exfat_volume_t* vol, const exfat_walk_visitor_t* visitor, void* ctx) {
+    int first_error = 0;
+    uint32_t depth = 1;
+
+    strcpy(walk_path, "/");
+    exfat_dir_open(&walk_stack[0].it, vol, vol->root_cluster, false, 0);
+    walk_stack[0].path_len = 1;
+
+    int result = exfat_walk_list(&walk_stack[0].it, 0, visitor, ctx);
+    if (result < 0) first_error = result;
+
+    // Each frame's iterator is advanced to the next subdirectory; listing a
+    // child leaves the parent's iterator untouched
+    while (depth > 0) {
+        exfat_walk_frame_t* f = &walk_stack[depth - 1];
+
+        result = exfat_dir_next(&f->it, &walk_entry);
+        if (result <= 0) {
+            if (result < 0 && first_error == 0) first_error = result;
+
+            depth--;
+            if (depth > 0) {
+                walk_path[walk_stack[depth - 1].path_len] = 0;
+            }
+            continue;
+        }
+
+        if (!(walk_entry.attributes & FAT_ATTR_DIRECTORY)) {
+            continue;
+        }
+
+        size_t name_len = strlen(walk_entry.name);
+        size_t sep = (f->path_len > 1) ? 1 : 0;
+        if (depth >= EXFAT_WALK_MAX_DEPTH || f->path_len + sep + name_len >= EXFAT_WALK_PATH_MAX) {
+            printf("  Skipping %s%s%s: depth or path limit reached\n",
+                   walk_path, sep ? "/" : "", walk_entry.name);
+            continue;
+        }
+
+        if (sep) walk_path[f->path_len] = '/';
+        memcpy(&walk_path[f->path_len + sep], walk_entry.name, name_len + 1);
+
+        exfat_walk_frame_t* next = &walk_stack[depth];
+        exfat_dir_open_entry(&next->it, vol, &walk_entry);
+        next->path_len = (uint16_t)(f->path_len + sep + name_len);
+
+        result = exfat_walk_list(&next->it, depth, visitor, ctx);
+        if (result < 0 && first_error == 0) first_error = result;
+        depth++;
+    }
+
+    return first_error;
+}
+
+// 'ls -lR' visitor
+typedef struct {
+    uint32_t dirs;
+    uint32_t files;
+    uint64_t bytes;
+    int dir_count;
+    uint64_t dir_bytes;
+} exfat_tree_stats_t;
+
+static void print_tree_enter(const char* path, uint32_t depth, void* ctx) {
+    (void)depth;
+    exfat_tree_stats_t* stats = ctx;
+    stats->dir_count = 0;
+    stats->dir_bytes = 0;
+    printf("\n  === Directory listing for %s ===\n", path);
+}
+
+static void print_tree_entry(const char* path, const exfat_dirent_t* ent, void* ctx) {
+    (void)path;
+    exfat_tree_stats_t* stats = ctx;
+
+    exfat_dir_print_entry(ent);
+    stats->dir_count++;
+
+    if (ent->attributes & FAT_ATTR_DIRECTORY) {
+        stats->dirs++;
+    } else {
+        stats->files++;
+        stats->bytes += ent->data_length;
+        stats->dir_bytes += ent->data_length;
+    }
+}
+
+static void print_tree_done(const char* path, void* ctx) {
+    (void)path;
+    exfat_tree_stats_t* stats = ctx;
+    printf("  total %d\n", (int)(stats->dir_bytes / 1024));
+    printf("  %d files and directories\n", stats->dir_count);
+}
+
+int exfat_walk_print_tree(exfat_volume_t* vol) {
+    exfat_tree_stats_t stats = {0};
+    const exfat_walk_visitor_t visitor = {
+        .enter_dir = print_tree_enter,
+        .entry = print_tree_entry,
+        .dir_done = print_tree_done,
+    };
+
+    int result = exfat_walk(vol, &visitor, &stats);
+
+    printf("\n  %u directories, %u files, %llu bytes\n",
+           stats.dirs, stats.files, (unsigned long long)stats.bytes);
+
+    if (result < 0) {
+        printf("  Walk finished with errors (%d)\n", result);
+    }
+    return result;
+}
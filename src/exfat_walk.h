@@ -0,0 +1,33 @@
+#ifndef EXFAT_WALK_H
+#define EXFAT_WALK_H
+
+#include "pico/stdlib.h"
+#include "exfat_volume.h"
+#include "exfat_dir.h"
+
+// Walker limits: memory is O(depth), independent of the number of files
+#define EXFAT_WALK_MAX_DEPTH 16
+#define EXFAT_WALK_PATH_MAX  512
+
+// Callbacks invoked during a walk; any of them may be NULL. enter_dir is
+// called before a directory's entries and dir_done after them; the
+// directory's subdirectories are visited after dir_done.
+typedef struct {
+    void (*enter_dir)(const char* path, uint32_t depth, void* ctx);
+    void (*entry)(const char* path, const exfat_dirent_t* ent, void* ctx);
+    void (*dir_done)(const char* path, void* ctx);
+} exfat_walk_visitor_t;
+
+// One level of the explicit walk stack: an iterator paused at the next
+// entry to consider for descent
+typedef struct {
+    exfat_dir_iter_t it;
+    uint16_t path_len;
+} exfat_walk_frame_t;
+
+int exfat_walk(exfat_volume_t* vol, const exfat_walk_visitor_t* visitor, void* ctx);
+
+// Recursive 'ls -lR' style listing of a whole volume
+int exfat_walk_print_tree(exfat_volume_t* vol);
+
+#endif // EXFAT_WALK_H
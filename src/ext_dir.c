@@ -0,0 +1,603 @@
+#include "ext_dir.h"
+#include "sd_analyzer.h"
+#include <stdio.h>
+#include <string.h>
+
+// htree root: dx_root_info follows the "." and ".." entries of block 0
+#define EXT_DX_ROOT_INFO    24
+#define EXT_DX_ROOT_ENTRIES 32
+#define EXT_DX_NODE_ENTRIES 8
+#define EXT_DX_MAX_LEVELS   3
+#define EXT_DX_CONTINUATIONS 8          // Leaf blocks sharing a colliding hash
+
+// Directory block shared by all iterators, tagged by inode and block
+static uint8_t dir_block[EXT_FILE_BLOCK_MAX];
+static uint32_t dir_block_lba = UINT32_MAX;
+static uint32_t dir_block_inode;
+static uint32_t dir_block_index;
+
+static uint32_t stat_lookups;
+static uint32_t stat_indexed;
+static uint32_t stat_blocks;
+
+static uint16_t read_le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void ext_dir_reset_stats(void) {
+    stat_lookups = 0;
+    stat_indexed = 0;
+    stat_blocks = 0;
+}
+
+void ext_dir_print_stats(void) {
+    printf("Directory lookups: %u (%u through the htree index), %u blocks scanned\n",
+           stat_lookups, stat_indexed, stat_blocks);
+}
+
+// Load logical block of a directory into dir_block
+static int ext_dir_load_block(ext_file_t* file, uint32_t block) {
+    const ext_volume_t* vol = file->vol;
+
+    if (dir_block_lba == vol->start_lba && dir_block_inode == file->inode.number &&
+        dir_block_index == block) {
+        return 0;
+    }
+
+    dir_block_lba = UINT32_MAX;
+    int32_t got = ext_file_read(file, (uint64_t)block * vol->block_size, dir_block, vol->block_size);
+    if (got < 0) {
+        return got;
+    }
+    if ((uint32_t)got != vol->block_size) {
+        return -5; // Directory size not a whole number of blocks
+    }
+
+    dir_block_lba = vol->start_lba;
+    dir_block_inode = file->inode.number;
+    dir_block_index = block;
+    return 0;
+}
+
+// Decode the entry at offset of dir_block. Returns its record length, or 0
+// when the record is damaged and the rest of the block must be skipped.
+static uint32_t ext_dir_parse(const ext_volume_t* vol, uint32_t offset, ext_dirent_t* ent) {
+    const uint8_t* e = &dir_block[offset];
+    uint32_t rec_len = read_le16(&e[4]);
+
+    if (offset + 8 > vol->block_size || rec_len < 8 || rec_len % 4 != 0 ||
+        offset + rec_len > vol->block_size) {
+        return 0;
+    }
+
+    ent->inode = read_le32(&e[0]);
+    if (vol->feature_incompat & EXT_INCOMPAT_FILETYPE) {
+        ent->name_len = e[6];
+        ent->file_type = e[7];
+    } else {
+        uint32_t name_len = read_le16(&e[6]);
+        ent->name_len = name_len > EXT_NAME_MAX ? EXT_NAME_MAX : (uint8_t)name_len;
+        ent->file_type = EXT_FT_UNKNOWN;
+    }
+
+    if (8u + ent->name_len > rec_len) {
+        return 0;
+    }
+
+    memcpy(ent->name, &e[8], ent->name_len);
+    ent->name[ent->name_len] = 0;
+    return rec_len;
+}
+
+int ext_dir_open(ext_dir_iter_t* it, const ext_volume_t* vol, const ext_inode_t* inode) {
+    memset(it, 0, sizeof(*it));
+
+    if ((inode->mode & EXT_S_IFMT) != EXT_S_IFDIR) {
+        return -6; // Not a directory
+    }
+    if (inode->flags & EXT_INODE_INLINE_DATA_FL) {
+        return -3; // Inline directories are not supported
+    }
+
+    return ext_file_open_inode(&it->file, vol, inode);
+}
+
+int ext_dir_next(ext_dir_iter_t* it, ext_dirent_t* ent) {
+    const ext_volume_t* vol = it->file.vol;
+    uint32_t blocks = (uint32_t)((it->file.size + vol->block_size - 1) / vol->block_size);
+
+    while (!it->done) {
+        if (it->block >= blocks) {
+            it->done = true;
+            break;
+        }
+
+        int result = ext_dir_load_block(&it->file, it->block);
+        if (result != 0) {
+            it->done = true;
+            it->error = result;
+            break;
+        }
+
+        uint32_t rec_len = ext_dir_parse(vol, it->offset, ent);
+        if (rec_len == 0 || it->offset + rec_len >= vol->block_size) {
+            it->block++;
+            it->offset = 0;
+        } else {
+            it->offset += rec_len;
+        }
+
+        // Unused records, htree nodes and checksum tails all have inode 0
+        if (rec_len != 0 && ent->inode != 0 && ent->name_len > 0) {
+            return 1;
+        }
+    }
+
+    return it->error;
+}
+
+// Linear scan of one block of the directory for a name
+static int ext_dir_scan_block(ext_file_t* file, uint32_t block, const char* name, size_t len,
+                              ext_dirent_t* ent) {
+    const ext_volume_t* vol = file->vol;
+
+    int result = ext_dir_load_block(file, block);
+    if (result != 0) {
+        return result;
+    }
+    stat_blocks++;
+
+    uint32_t offset = 0;
+    while (offset < vol->block_size) {
+        uint32_t rec_len = ext_dir_parse(vol, offset, ent);
+        if (rec_len == 0) {
+            break;
+        }
+        if (ent->inode != 0 && ent->name_len == len && memcmp(ent->name, name, len) == 0) {
+            return 1;
+        }
+        offset += rec_len;
+    }
+    return 0;
+}
+
+// String packing shared by the half-MD4 and TEA hashes
+static void ext_str2hashbuf(const char* msg, size_t len, uint32_t* buf, int num, bool is_unsigned) {
+    uint32_t pad = (uint32_t)len | ((uint32_t)len << 8);
+    pad |= pad << 16;
+
+    uint32_t val = pad;
+    if (len > (size_t)num * 4) {
+        len = num * 4;
+    }
+    for (size_t i = 0; i < len; i++) {
+        int c = is_unsigned ? (int)(uint8_t)msg[i] : (int)(int8_t)msg[i];
+        val = (uint32_t)c + (val << 8);
+        if ((i % 4) == 3) {
+            *buf++ = val;
+            val = pad;
+            num--;
+        }
+    }
+    if (--num >= 0) {
+        *buf++ = val;
+    }
+    while (--num >= 0) {
+        *buf++ = pad;
+    }
+}
+
+static inline uint32_t rol32(uint32_t v, int s) {
+    return (v << s) | (v >> (32 - s));
+}
+
+#define MD4_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD4_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define MD4_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD4_ROUND(f, a, b, c, d, x, s) (a += f(b, c, d) + (x), a = rol32(a, s))
+#define MD4_K2 013240474631u
+#define MD4_K3 015666365641u
+
+static void ext_half_md4(uint32_t buf[4], const uint32_t in[8]) {
+    uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+    MD4_ROUND(MD4_F, a, b, c, d, in[0], 3);
+    MD4_ROUND(MD4_F, d, a, b, c, in[1], 7);
+    MD4_ROUND(MD4_F, c, d, a, b, in[2], 11);
+    MD4_ROUND(MD4_F, b, c, d, a, in[3], 19);
+    MD4_ROUND(MD4_F, a, b, c, d, in[4], 3);
+    MD4_ROUND(MD4_F, d, a, b, c, in[5], 7);
+    MD4_ROUND(MD4_F, c, d, a, b, in[6], 11);
+    MD4_ROUND(MD4_F, b, c, d, a, in[7], 19);
+
+    MD4_ROUND(MD4_G, a, b, c, d, in[1] + MD4_K2, 3);
+    MD4_ROUND(MD4_G, d, a, b, c, in[3] + MD4_K2, 5);
+    MD4_ROUND(MD4_G, c, d, a, b, in[5] + MD4_K2, 9);
+    MD4_ROUND(MD4_G, b, c, d, a, in[7] + MD4_K2, 13);
+    MD4_ROUND(MD4_G, a, b, c, d, in[0] + MD4_K2, 3);
+    MD4_ROUND(MD4_G, d, a, b, c, in[2] + MD4_K2, 5);
+    MD4_ROUND(MD4_G, c, d, a, b, in[4] + MD4_K2, 9);
+    MD4_ROUND(MD4_G, b, c, d, a, in[6] + MD4_K2, 13);
+
+    MD4_ROUND(MD4_H, a, b, c, d, in[3] + MD4_K3, 3);
+    MD4_ROUND(MD4_H, d, a, b, c, in[7] + MD4_K3, 9);
+    MD4_ROUND(MD4_H, c, d, a, b, in[2] + MD4_K3, 11);
+    MD4_ROUND(MD4_H, b, c, d, a, in[6] + MD4_K3, 15);
+    MD4_ROUND(MD4_H, a, b, c, d, in[1] + MD4_K3, 3);
+    MD4_ROUND(MD4_H, d, a, b, c, in[5] + MD4_K3, 9);
+    MD4_ROUND(MD4_H, c, d, a, b, in[0] + MD4_K3, 11);
+    MD4_ROUND(MD4_H, b, c, d, a, in[4] + MD4_K3, 15);
+
+    buf[0] += a;
+    buf[1] += b;
+    buf[2] += c;
+    buf[3] += d;
+}
+
+static void ext_tea(uint32_t buf[4], const uint32_t in[4]) {
+    uint32_t sum = 0;
+    uint32_t b0 = buf[0], b1 = buf[1];
+
+    for (int n = 0; n < 16; n++) {
+        sum += 0x9E3779B9;
+        b0 += ((b1 << 4) + in[0]) ^ (b1 + sum) ^ ((b1 >> 5) + in[1]);
+        b1 += ((b0 << 4) + in[2]) ^ (b0 + sum) ^ ((b0 >> 5) + in[3]);
+    }
+
+    buf[0] += b0;
+    buf[1] += b1;
+}
+
+uint32_t ext_dir_hash(const ext_volume_t* vol, uint8_t version, const char* name, size_t len) {
+    uint32_t buf[4] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476};
+    uint32_t in[8];
+    uint32_t hash = 0;
+
+    bool is_unsigned = (vol->flags & EXT_FLAGS_UNSIGNED_HASH) != 0;
+    if (version > EXT_HASH_TEA) {
+        version -= 3; // Explicitly unsigned variants
+        is_unsigned = true;
+    }
+
+    // A zero seed means the default one
+    if (vol->hash_seed[0] | vol->hash_seed[1] | vol->hash_seed[2] | vol->hash_seed[3]) {
+        memcpy(buf, vol->hash_seed, sizeof(buf));
+    }
+
+    switch (version) {
+        case EXT_HASH_LEGACY: {
+            uint32_t h0 = 0x12A3FE2D, h1 = 0x37ABE8F9;
+            for (size_t i = 0; i < len; i++) {
+                int c = is_unsigned ? (int)(uint8_t)name[i] : (int)(int8_t)name[i];
+                uint32_t h = h1 + (h0 ^ (uint32_t)(c * 7152373));
+                if (h & 0x80000000) h -= 0x7FFFFFFF;
+                h1 = h0;
+                h0 = h;
+            }
+            hash = h0 << 1;
+            break;
+        }
+
+        case EXT_HASH_HALF_MD4:
+            for (size_t done = 0; done < len; done += 32) {
+                ext_str2hashbuf(name + done, len - done, in, 8, is_unsigned);
+                ext_half_md4(buf, in);
+            }
+            hash = buf[1];
+            break;
+
+        case EXT_HASH_TEA:
+            for (size_t done = 0; done < len; done += 16) {
+                ext_str2hashbuf(name + done, len - done, in, 4, is_unsigned);
+                ext_tea(buf, in);
+            }
+            hash = buf[0];
+            break;
+
+        default:
+            break;
+    }
+
+    hash &= ~1u;
+    if (hash == 0xFFFFFFFE) {
+        hash = 0xFFFFFFFC; // Reserved end-of-directory value
+    }
+    return hash;
+}
+
+// One index block on the path from the htree root to a leaf
+typedef struct {
+    uint32_t block;             // Logical block of the index node, 0 for the root
+    uint32_t entries_at;        // Offset of its dx entries (count and limit first)
+    uint32_t count;
+    uint32_t slot;              // Entry followed towards the leaf
+} ext_dx_frame_t;
+
+// Load an index block and check its entry table; returns the entry count,
+// or 0 when the table is damaged
+static uint32_t ext_dir_dx_load(ext_file_t* file, ext_dx_frame_t* frame) {
+    if (ext_dir_load_block(file, frame->block) != 0) {
+        return 0;
+    }
+    stat_blocks++;
+
+    const uint8_t* entries = &dir_block[frame->entries_at];
+    uint32_t limit = read_le16(&entries[0]);
+    uint32_t count = read_le16(&entries[2]);
+    if (count == 0 || count > limit || frame->entries_at + limit * 8 > file->vol->block_size) {
+        return 0;
+    }
+    return count;
+}
+
+// Walk the htree to the leaf blocks that may hold the name. Returns the
+// number of candidate blocks, or 0 when the index is unusable and the
+// caller should fall back to a linear scan.
+static uint32_t ext_dir_dx_leaves(ext_file_t* file, const char* name, size_t len,
+                                  uint32_t leaves[EXT_DX_CONTINUATIONS]) {
+    const ext_volume_t* vol = file->vol;
+    ext_dx_frame_t frames[EXT_DX_MAX_LEVELS];
+
+    if (ext_dir_load_block(file, 0) != 0) {
+        return 0;
+    }
+
+    const uint8_t* info = &dir_block[EXT_DX_ROOT_INFO];
+    uint8_t version = info[4];
+    uint8_t levels = info[6];
+    if (read_le32(&info[0]) != 0 || info[5] != 8 || levels >= EXT_DX_MAX_LEVELS || version > 5) {
+        return 0;
+    }
+
+    uint32_t hash = ext_dir_hash(vol, version, name, len);
+    uint32_t block = 0;
+
+    for (uint32_t level = 0; level <= levels; level++) {
+        ext_dx_frame_t* f = &frames[level];
+        f->block = block;
+        f->entries_at = level == 0 ? EXT_DX_ROOT_ENTRIES : EXT_DX_NODE_ENTRIES;
+        f->count = ext_dir_dx_load(file, f);
+        if (f->count == 0) {
+            return 0;
+        }
+
+        // Last entry whose hash is at or below the name's; entry 0 has none
+        const uint8_t* entries = &dir_block[f->entries_at];
+        uint32_t low = 1, high = f->count;
+        while (low < high) {
+            uint32_t mid = (low + high) / 2;
+            if (read_le32(&entries[mid * 8]) <= hash) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        f->slot = low - 1;
+        block = read_le32(&entries[f->slot * 8 + 4]) & 0x0FFFFFFF;
+    }
+
+    // Names whose hash collides may carry on in the following leaves, even
+    // past the end of an index node, as in ext4_htree_next_block(): step
+    // the lowest frame that has a next entry and stop unless that entry
+    // starts with the same hash
+    uint32_t n = 0;
+    leaves[n++] = block;
+    while (n < EXT_DX_CONTINUATIONS) {
+        int level = levels;
+        while (level >= 0 && frames[level].slot + 1 >= frames[level].count) {
+            level--;
+        }
+        if (level < 0) {
+            break;
+        }
+
+        ext_dx_frame_t* f = &frames[level];
+        if (ext_dir_load_block(file, f->block) != 0) {
+            break;
+        }
+        f->slot++;
+        const uint8_t* entry = &dir_block[f->entries_at + f->slot * 8];
+        if ((read_le32(&entry[0]) & ~1u) != hash) {
+            break;
+        }
+        block = read_le32(&entry[4]) & 0x0FFFFFFF;
+
+        // Down the leftmost path of the subtree below
+        bool damaged = false;
+        for (uint32_t below = level + 1; below <= levels; below++) {
+            frames[below].block = block;
+            frames[below].entries_at = EXT_DX_NODE_ENTRIES;
+            frames[below].count = ext_dir_dx_load(file, &frames[below]);
+            frames[below].slot = 0;
+            if (frames[below].count == 0) {
+                damaged = true;
+                break;
+            }
+            block = read_le32(&dir_block[EXT_DX_NODE_ENTRIES + 4]) & 0x0FFFFFFF;
+        }
+        if (damaged) {
+            break;
+        }
+        leaves[n++] = block;
+    }
+    return n;
+}
+
+int ext_dir_find(const ext_volume_t* vol, const ext_inode_t* dir, const char* name, size_t len,
+                 ext_dirent_t* ent) {
+    static ext_file_t file;
+    uint32_t leaves[EXT_DX_CONTINUATIONS];
+
+    if ((dir->mode & EXT_S_IFMT) != EXT_S_IFDIR) {
+        return -6;
+    }
+    if (dir->flags & EXT_INODE_INLINE_DATA_FL) {
+        return -3;
+    }
+    if (len == 0 || len > EXT_NAME_MAX) {
+        return 0;
+    }
+
+    int result = ext_file_open_inode(&file, vol, dir);
+    if (result != 0) {
+        return result;
+    }
+    stat_lookups++;
+
+    // "." and ".." sit in block 0 ahead of the htree root and are never
+    // hashed into a leaf, so they are looked up there directly
+    bool dots = (len == 1 && name[0] == '.') || (len == 2 && name[0] == '.' && name[1] == '.');
+
+    if (dots && (dir->flags & EXT_INODE_INDEX_FL)) {
+        return ext_dir_scan_block(&file, 0, name, len, ent);
+    }
+
+    if ((dir->flags & EXT_INODE_INDEX_FL) && (vol->feature_compat & EXT_COMPAT_DIR_INDEX)) {
+        uint32_t n = ext_dir_dx_leaves(&file, name, len, leaves);
+        if (n > 0) {
+            stat_indexed++;
+            for (uint32_t i = 0; i < n; i++) {
+                result = ext_dir_scan_block(&file, leaves[i], name, len, ent);
+                if (result != 0) {
+                    return result;
+                }
+            }
+            return 0;
+        }
+    }
+
+    uint32_t blocks = (uint32_t)((file.size + vol->block_size - 1) / vol->block_size);
+    for (uint32_t block = 0; block < blocks; block++) {
+        result = ext_dir_scan_block(&file, block, name, len, ent);
+        if (result != 0) {
+            return result;
+        }
+    }
+    return 0;
+}
+
+// Unix time as the FAT date and time the shared formatter expects.
+// Dates outside 1980-2107 come out as "??? ?? ??:??".
+static void ext_unix_to_fat(uint32_t t, uint16_t* date, uint16_t* time) {
+    uint32_t days = t / 86400;
+    uint32_t secs = t % 86400;
+
+    // Civil date from days since 1970-01-01 (proleptic Gregorian)
+    uint32_t z = days + 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+    uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+    uint32_t year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+
+    if (year < 1980 || year > 2107) {
+        *date = 0;
+        *time = 0;
+        return;
+    }
+
+    *date = (uint16_t)(((year - 1980) << 9) | (month << 5) | day);
+    *time = (uint16_t)(((secs / 3600) << 11) | (((secs / 60) % 60) << 5) | ((secs % 60) / 2));
+}
+
+static char ext_dir_type_char(uint16_t mode) {
+    switch (mode & EXT_S_IFMT) {
+        case EXT_S_IFDIR:  return 'd';
+        case EXT_S_IFLNK:  return 'l';
+        case EXT_S_IFCHR:  return 'c';
+        case EXT_S_IFBLK:  return 'b';
+        case EXT_S_IFIFO:  return 'p';
+        case EXT_S_IFSOCK: return 's';
+        default:           return '-';
+    }
+}
+
+void ext_dir_print_entry(const ext_volume_t* vol, const ext_dirent_t* ent, const ext_inode_t* inode) {
+    uint16_t mode = inode->mode;
+    char perms[11];
+
+    perms[0] = ext_dir_type_char(mode);
+    for (int i = 0; i < 3; i++) {
+        uint16_t bits = mode >> (6 - i * 3);
+        perms[1 + i * 3] = (bits & 4) ? 'r' : '-';
+        perms[2 + i * 3] = (bits & 2) ? 'w' : '-';
+        perms[3 + i * 3] = (bits & 1) ? 'x' : '-';
+    }
+    if (mode & 04000) perms[3] = (mode & 0100) ? 's' : 'S';
+    if (mode & 02000) perms[6] = (mode & 0010) ? 's' : 'S';
+    if (mode & 01000) perms[9] = (mode & 0001) ? 't' : 'T';
+    perms[10] = 0;
+
+    printf("  %s %2u", perms, inode->links);
+
+    if ((mode & EXT_S_IFMT) == EXT_S_IFDIR) {
+        printf(" %10s", "<DIR>");
+    } else {
+        printf(" %10llu", (unsigned long long)inode->size);
+    }
+
+    uint16_t date, time;
+    char datetime_str[32];
+    ext_unix_to_fat(inode->mtime, &date, &time);
+    sd_analyzer_format_fat_datetime(date, time, datetime_str, sizeof(datetime_str));
+    printf(" %s %s", datetime_str, ent->name);
+
+    if ((mode & EXT_S_IFMT) == EXT_S_IFLNK) {
+        static ext_file_t link;
+        char target[EXT_NAME_MAX + 1];
+
+        int32_t got = -1;
+        if (ext_file_open_inode(&link, vol, inode) == 0) {
+            got = ext_file_read(&link, 0, (uint8_t*)target, EXT_NAME_MAX);
+        }
+        if (got >= 0) {
+            target[got] = 0;
+            printf(" -> %s%s", target, inode->size > EXT_NAME_MAX ? "..." : "");
+        }
+    }
+
+    printf("\n");
+}
+
+int ext_dir_list(const ext_volume_t* vol, const ext_inode_t* dir, const char* path) {
+    static ext_dir_iter_t it;
+    static ext_dirent_t ent;
+    ext_inode_t inode;
+    int count = 0;
+    uint64_t bytes = 0;
+
+    int result = ext_dir_open(&it, vol, dir);
+    if (result != 0) {
+        return result;
+    }
+
+    printf("\n  === Directory listing for %s ===\n", path);
+
+    while ((result = ext_dir_next(&it, &ent)) > 0) {
+        if (strcmp(ent.name, ".") == 0 || strcmp(ent.name, "..") == 0) {
+            continue;
+        }
+
+        if (ext_inode_read(vol, ent.inode, &inode) != 0) {
+            printf("  ?????????? inode %u unreadable  %s\n", ent.inode, ent.name);
+            continue;
+        }
+
+        ext_dir_print_entry(vol, &ent, &inode);
+        count++;
+        if ((inode.mode & EXT_S_IFMT) != EXT_S_IFDIR) {
+            bytes += inode.size;
+        }
+    }
+
+    printf("  total %d\n", (int)(bytes / 1024));
+    printf("  %d files and directories\n", count);
+    return result;
+}
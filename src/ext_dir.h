@@ -0,0 +1,67 @@
+#ifndef EXT_DIR_H
+#define EXT_DIR_H
+
+#include "pico/stdlib.h"
+#include "ext_volume.h"
+#include "ext_inode.h"
+#include "ext_file.h"
+
+#define EXT_NAME_MAX 255
+
+// Directory entry file types (filetype feature)
+#define EXT_FT_UNKNOWN  0
+#define EXT_FT_REG_FILE 1
+#define EXT_FT_DIR      2
+#define EXT_FT_CHRDEV   3
+#define EXT_FT_BLKDEV   4
+#define EXT_FT_FIFO     5
+#define EXT_FT_SOCK     6
+#define EXT_FT_SYMLINK  7
+
+// htree hash versions; the unsigned variants are selected by s_flags
+#define EXT_HASH_LEGACY   0
+#define EXT_HASH_HALF_MD4 1
+#define EXT_HASH_TEA      2
+
+typedef struct {
+    uint32_t inode;
+    uint8_t file_type;
+    uint8_t name_len;
+    char name[EXT_NAME_MAX + 1];
+} ext_dirent_t;
+
+// Linear iterator over one directory, a block at a time. Blocks go
+// through a shared buffer, so iterators are cheap to copy.
+typedef struct {
+    ext_file_t file;
+    uint32_t block;             // Logical block of the next entry
+    uint32_t offset;            // Byte offset in that block
+    bool done;
+    int error;
+} ext_dir_iter_t;
+
+// Open a directory by inode; -6 if it is not a directory
+int ext_dir_open(ext_dir_iter_t* it, const ext_volume_t* vol, const ext_inode_t* inode);
+
+// Next entry in use. Returns 1, 0 at the end, or an error.
+int ext_dir_next(ext_dir_iter_t* it, ext_dirent_t* ent);
+
+// htree hash of a name, as stored in dx entries (low bit clear)
+uint32_t ext_dir_hash(const ext_volume_t* vol, uint8_t version, const char* name, size_t len);
+
+// Find a name in a directory: through the htree index when there is one,
+// else by a linear scan. Returns 1, 0 if absent, or an error.
+int ext_dir_find(const ext_volume_t* vol, const ext_inode_t* dir, const char* name, size_t len,
+                 ext_dirent_t* ent);
+
+// Blocks read by lookups since the last reset, and how many used the index
+void ext_dir_reset_stats(void);
+void ext_dir_print_stats(void);
+
+// Print one entry in the same 'ls -l' style as fat_dir_print_entry()
+void ext_dir_print_entry(const ext_volume_t* vol, const ext_dirent_t* ent, const ext_inode_t* inode);
+
+// 'ls -l' listing of one directory
+int ext_dir_list(const ext_volume_t* vol, const ext_inode_t* dir, const char* path);
+
+#endif // EXT_DIR_H
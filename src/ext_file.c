@@ -0,0 +1,307 @@
+#include "ext_file.h"
+#include "sd_block.h"
+#include <string.h>
+
+#define EXT_EXTENT_MAGIC     0xF30A
+#define EXT_EXTENT_MAX_DEPTH 5
+#define EXT_EXTENT_INIT_MAX  32768      // Longer lengths mark unwritten extents
+
+// One mapping block per level, tagged with its LBA
+static uint8_t node_blocks[EXT_FILE_NODE_LEVELS][EXT_FILE_BLOCK_MAX];
+static uint32_t node_lba[EXT_FILE_NODE_LEVELS] = {UINT32_MAX, UINT32_MAX, UINT32_MAX};
+
+// Bounce buffer for reads that start or end inside a sector
+static uint8_t file_sector[512];
+
+static uint16_t read_le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Small files and short symlink targets live in i_block itself
+static bool ext_file_is_inline(const ext_inode_t* inode) {
+    if (inode->flags & EXT_INODE_INLINE_DATA_FL) {
+        return true;
+    }
+    return (inode->mode & EXT_S_IFMT) == EXT_S_IFLNK && inode->size < sizeof(inode->block) &&
+           !(inode->flags & EXT_INODE_EXTENTS_FL);
+}
+
+int ext_file_open_inode(ext_file_t* file, const ext_volume_t* vol, const ext_inode_t* inode) {
+    memset(file, 0, sizeof(*file));
+    file->vol = vol;
+    file->inode = *inode;
+    file->size = inode->size;
+
+    if (!ext_file_is_inline(inode) && vol->block_size > EXT_FILE_BLOCK_MAX) {
+        return -3; // Mapping blocks too large to buffer
+    }
+    return 0;
+}
+
+int ext_file_open(ext_file_t* file, const ext_volume_t* vol, uint32_t number) {
+    ext_inode_t inode;
+
+    int result = ext_inode_read(vol, number, &inode);
+    if (result != 0) {
+        return result;
+    }
+    return ext_file_open_inode(file, vol, &inode);
+}
+
+// Mapping block at level, read only when the level holds another block
+static const uint8_t* ext_file_node(const ext_volume_t* vol, uint32_t level, uint64_t block) {
+    if (level >= EXT_FILE_NODE_LEVELS) {
+        level = EXT_FILE_NODE_LEVELS - 1;
+    }
+
+    if (block == 0 || block >= vol->blocks_count) {
+        return NULL;
+    }
+
+    uint32_t lba = ext_volume_block_to_lba(vol, block);
+    if (node_lba[level] != lba) {
+        node_lba[level] = UINT32_MAX;
+        if (sd_read_blocks(lba, vol->sectors_per_block, node_blocks[level]) != 0) {
+            return NULL;
+        }
+        node_lba[level] = lba;
+    }
+    return node_blocks[level];
+}
+
+// Descend the extent tree to the leaf covering logical. Each level narrows
+// limit to where the next subtree starts, which bounds a trailing hole.
+static int ext_file_map_extents(ext_file_t* file, uint32_t logical, ext_run_t* run) {
+    const ext_volume_t* vol = file->vol;
+    const uint8_t* node = file->inode.block;
+    uint32_t node_bytes = sizeof(file->inode.block);
+    uint64_t limit = (uint64_t)UINT32_MAX + 1;
+
+    for (uint32_t level = 0; level <= EXT_EXTENT_MAX_DEPTH; level++) {
+        uint16_t entries = read_le16(&node[2]);
+        uint16_t depth = read_le16(&node[6]);
+        if (read_le16(&node[0]) != EXT_EXTENT_MAGIC || entries > (node_bytes - 12) / 12) {
+            return -4;
+        }
+
+        // Last entry starting at or before logical
+        int found = -1;
+        for (uint32_t i = 0; i < entries; i++) {
+            uint32_t start = read_le32(&node[12 + i * 12]);
+            if (start > logical) {
+                if (start < limit) limit = start;
+                break;
+            }
+            found = (int)i;
+        }
+
+        run->logical = logical;
+        run->physical = 0;
+        run->unwritten = false;
+
+        if (depth == 0) {
+            if (found >= 0) {
+                const uint8_t* e = &node[12 + found * 12];
+                uint32_t start = read_le32(&e[0]);
+                uint32_t length = read_le16(&e[4]);
+                if (length > EXT_EXTENT_INIT_MAX) {
+                    length -= EXT_EXTENT_INIT_MAX;
+                    run->unwritten = true;
+                }
+
+                if (logical - start < length) {
+                    run->physical = (((uint64_t)read_le16(&e[6]) << 32) | read_le32(&e[8])) + (logical - start);
+                    run->count = length - (logical - start);
+                    if (run->physical + run->count > vol->blocks_count) {
+                        return -4;
+                    }
+                    return 0;
+                }
+                run->unwritten = false;
+            }
+
+            // Hole up to the next extent or subtree
+            run->count = (uint32_t)(limit - logical > UINT32_MAX ? UINT32_MAX : limit - logical);
+            return 0;
+        }
+
+        if (found < 0) {
+            run->count = (uint32_t)(limit - logical > UINT32_MAX ? UINT32_MAX : limit - logical);
+            return 0;
+        }
+
+        const uint8_t* index = &node[12 + found * 12];
+        uint64_t child = read_le32(&index[4]) | ((uint64_t)read_le16(&index[8]) << 32);
+        node = ext_file_node(vol, level, child);
+        if (!node) {
+            return -4;
+        }
+        node_bytes = vol->block_size;
+    }
+
+    return -4; // Deeper than any valid tree
+}
+
+// Direct blocks, then single, double and triple indirect blocks. The run
+// extends over following pointers of the same block that stay consecutive.
+static int ext_file_map_indirect(ext_file_t* file, uint32_t logical, ext_run_t* run) {
+    const ext_volume_t* vol = file->vol;
+    uint64_t ptrs = vol->block_size / 4;
+    const uint8_t* list = file->inode.block;
+    uint32_t list_len = 12;
+    uint32_t index = logical;
+
+    run->logical = logical;
+    run->physical = 0;
+    run->unwritten = false;
+
+    if (logical >= 12) {
+        uint64_t rel = logical - 12;
+        uint32_t levels = 1;
+        uint64_t span = ptrs;                   // Blocks under the top pointer
+        while (rel >= span && levels < 3) {
+            rel -= span;
+            levels++;
+            span *= ptrs;
+        }
+        if (rel >= span) {
+            run->count = 1;
+            return 0; // Past the triple indirect block: a hole
+        }
+
+        uint64_t block = read_le32(&file->inode.block[(11 + levels) * 4]);
+        for (uint32_t level = 0; level < levels; level++) {
+            if (block == 0) {
+                // Missing mapping block: everything under it is a hole
+                uint64_t left = span - rel;
+                run->count = (uint32_t)(left > UINT32_MAX ? UINT32_MAX : left);
+                return 0;
+            }
+
+            const uint8_t* node = ext_file_node(vol, level, block);
+            if (!node) {
+                return -4;
+            }
+
+            span /= ptrs;                       // Blocks under each entry of node
+            if (level + 1 == levels) {
+                list = node;
+                list_len = (uint32_t)ptrs;
+                index = (uint32_t)rel;
+            } else {
+                block = read_le32(&node[(rel / span) * 4]);
+                rel %= span;
+            }
+        }
+    }
+
+    uint32_t first = read_le32(&list[index * 4]);
+    uint32_t count = 1;
+    while (index + count < list_len &&
+           read_le32(&list[(index + count) * 4]) == (first ? first + count : 0)) {
+        count++;
+    }
+
+    if (first != 0 && (uint64_t)first + count > vol->blocks_count) {
+        return -4;
+    }
+
+    run->physical = first;
+    run->count = count;
+    return 0;
+}
+
+int ext_file_map(ext_file_t* file, uint32_t logical, ext_run_t* run) {
+    if (file->run.count > 0 && logical - file->run.logical < file->run.count) {
+        *run = file->run;
+        return 0;
+    }
+
+    int result = (file->inode.flags & EXT_INODE_EXTENTS_FL)
+                 ? ext_file_map_extents(file, logical, run)
+                 : ext_file_map_indirect(file, logical, run);
+    if (result != 0) {
+        return result;
+    }
+
+    file->run = *run;
+    file->runs_mapped++;
+    return 0;
+}
+
+int32_t ext_file_read(ext_file_t* file, uint64_t offset, uint8_t* buffer, uint32_t length) {
+    const ext_volume_t* vol = file->vol;
+    uint32_t block_size = vol->block_size;
+    uint32_t done = 0;
+
+    if (offset >= file->size) {
+        return 0;
+    }
+    if (length > file->size - offset) {
+        length = (uint32_t)(file->size - offset);
+    }
+
+    if (ext_file_is_inline(&file->inode)) {
+        // Only the part kept in i_block; inline data spilling into the
+        // system.data attribute is not read
+        if (offset >= sizeof(file->inode.block)) {
+            return -5;
+        }
+        if (length > sizeof(file->inode.block) - offset) {
+            length = (uint32_t)(sizeof(file->inode.block) - offset);
+        }
+        memcpy(buffer, &file->inode.block[offset], length);
+        return (int32_t)length;
+    }
+
+    while (done < length) {
+        uint64_t pos = offset + done;
+        uint64_t logical = pos / block_size;
+        if (logical > UINT32_MAX) {
+            return -5;
+        }
+
+        ext_run_t run;
+        int result = ext_file_map(file, (uint32_t)logical, &run);
+        if (result != 0) {
+            return result;
+        }
+
+        uint64_t run_offset = pos - (uint64_t)run.logical * block_size;
+        uint64_t run_left = (uint64_t)run.count * block_size - run_offset;
+        uint32_t want = length - done;
+        if (want > run_left) want = (uint32_t)run_left;
+
+        if (run.physical == 0 || run.unwritten) {
+            memset(buffer + done, 0, want);
+            done += want;
+            continue;
+        }
+
+        uint32_t lba = ext_volume_block_to_lba(vol, run.physical) + (uint32_t)(run_offset / 512);
+        uint32_t in_sector = (uint32_t)(run_offset % 512);
+
+        if (in_sector == 0 && want >= 512) {
+            // Whole sectors of the run go straight into the caller's buffer
+            uint32_t sectors = want / 512;
+            if (sd_read_blocks(lba, sectors, buffer + done) != 0) {
+                return -1;
+            }
+            done += sectors * 512;
+        } else {
+            uint32_t chunk = 512 - in_sector;
+            if (chunk > want) chunk = want;
+            if (sd_read_block(lba, file_sector) != 0) {
+                return -1;
+            }
+            memcpy(buffer + done, file_sector + in_sector, chunk);
+            done += chunk;
+        }
+    }
+
+    return (int32_t)done;
+}
@@ -0,0 +1,43 @@
+#ifndef EXT_FILE_H
+#define EXT_FILE_H
+
+#include "pico/stdlib.h"
+#include "ext_volume.h"
+#include "ext_inode.h"
+
+// Largest block size whose extent and indirect blocks can be buffered
+#define EXT_FILE_BLOCK_MAX 4096
+
+// Mapping blocks kept per tree level; deeper levels share the last one
+#define EXT_FILE_NODE_LEVELS 3
+
+// Run of file blocks stored in consecutive volume blocks. A hole has
+// physical 0; an unwritten (preallocated) extent reads as zeros too.
+typedef struct {
+    uint32_t logical;
+    uint64_t physical;
+    uint32_t count;
+    bool unwritten;
+} ext_run_t;
+
+// Open file on an ext volume. Blocks are mapped one run at a time, through
+// the extent tree on ext4 or the direct and indirect block pointers on
+// ext2/3; each run is then read with one multi-block transfer.
+typedef struct {
+    const ext_volume_t* vol;
+    ext_inode_t inode;
+    uint64_t size;
+    ext_run_t run;              // Last mapped run (count 0 = none)
+    uint32_t runs_mapped;
+} ext_file_t;
+
+int ext_file_open_inode(ext_file_t* file, const ext_volume_t* vol, const ext_inode_t* inode);
+int ext_file_open(ext_file_t* file, const ext_volume_t* vol, uint32_t number);
+
+// Run holding file block logical; -4 for damaged mapping blocks
+int ext_file_map(ext_file_t* file, uint32_t logical, ext_run_t* run);
+
+// Read up to length bytes at offset; returns bytes read or a negative error
+int32_t ext_file_read(ext_file_t* file, uint64_t offset, uint8_t* buffer, uint32_t length);
+
+#endif // EXT_FILE_H
@@ -0,0 +1,110 @@
+#include "ext_inode.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <string.h>
+
+// Window of inode table sectors, and the group whose table it belongs to
+static uint8_t inode_window[EXT_INODE_WINDOW_SECTORS * 512];
+static uint32_t window_lba = UINT32_MAX;
+static uint32_t window_sectors;
+static const ext_volume_t* group_vol;
+static uint32_t group_start_lba;
+static uint32_t group_number = UINT32_MAX;
+static ext_group_t group_desc;
+static uint32_t window_hits;
+static uint32_t window_misses;
+
+static uint16_t read_le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void ext_inode_cache_reset(void) {
+    window_lba = UINT32_MAX;
+    window_sectors = 0;
+    group_vol = NULL;
+    group_number = UINT32_MAX;
+}
+
+void ext_inode_print_cache_stats(void) {
+    printf("Inode window: %u hits, %u loads (%u sectors each)\n",
+           window_hits, window_misses, EXT_INODE_WINDOW_SECTORS);
+}
+
+static void ext_inode_decode(const ext_volume_t* vol, const uint8_t* raw, ext_inode_t* inode) {
+    inode->mode = read_le16(&raw[0]);
+    inode->uid = read_le16(&raw[2]) | ((uint32_t)read_le16(&raw[120]) << 16);
+    inode->size = read_le32(&raw[4]) | ((uint64_t)read_le32(&raw[108]) << 32);
+    inode->atime = read_le32(&raw[8]);
+    inode->ctime = read_le32(&raw[12]);
+    inode->mtime = read_le32(&raw[16]);
+    inode->gid = read_le16(&raw[24]) | ((uint32_t)read_le16(&raw[122]) << 16);
+    inode->links = read_le16(&raw[26]);
+    inode->flags = read_le32(&raw[32]);
+    memcpy(inode->block, &raw[40], sizeof(inode->block));
+
+    // i_blocks counts 512-byte units unless huge_file says file blocks
+    uint64_t blocks = read_le32(&raw[28]);
+    if (vol->feature_ro_compat & EXT_RO_COMPAT_HUGE_FILE) {
+        blocks |= (uint64_t)read_le16(&raw[116]) << 32;
+        if (inode->flags & EXT_INODE_HUGE_FILE_FL) {
+            blocks *= vol->sectors_per_block;
+        }
+    }
+    inode->sectors = blocks;
+}
+
+int ext_inode_read(const ext_volume_t* vol, uint32_t number, ext_inode_t* inode) {
+    if (number == 0 || number > vol->inodes_count) {
+        return -4;
+    }
+
+    uint32_t group = (number - 1) / vol->inodes_per_group;
+    uint32_t index = (number - 1) % vol->inodes_per_group;
+
+    if (group_vol != vol || group_start_lba != vol->start_lba || group_number != group) {
+        int result = ext_volume_read_group(vol, group, &group_desc);
+        if (result != 0) {
+            return result;
+        }
+        group_vol = vol;
+        group_start_lba = vol->start_lba;
+        group_number = group;
+    }
+
+    uint32_t table_sectors = (vol->inodes_per_group * vol->inode_size + 511) / 512;
+    uint32_t table_lba = ext_volume_block_to_lba(vol, group_desc.inode_table);
+    uint32_t offset = index * vol->inode_size;
+    uint32_t lba = table_lba + offset / 512;
+
+    if (group_desc.inode_table + (table_sectors + vol->sectors_per_block - 1) / vol->sectors_per_block >
+        vol->blocks_count) {
+        return -4; // Inode table outside the volume
+    }
+
+    if (lba < window_lba || lba >= window_lba + window_sectors) {
+        // Aligned window within the group's inode table
+        uint32_t first = (offset / 512) / EXT_INODE_WINDOW_SECTORS * EXT_INODE_WINDOW_SECTORS;
+        uint32_t count = table_sectors - first;
+        if (count > EXT_INODE_WINDOW_SECTORS) count = EXT_INODE_WINDOW_SECTORS;
+
+        window_lba = UINT32_MAX;
+        if (sd_read_blocks(table_lba + first, count, inode_window) != 0) {
+            return -1;
+        }
+        window_lba = table_lba + first;
+        window_sectors = count;
+        window_misses++;
+    } else {
+        window_hits++;
+    }
+
+    // Inode sizes are powers of two from 128, so the first 128 bytes that
+    // are decoded never straddle a sector
+    ext_inode_decode(vol, &inode_window[(lba - window_lba) * 512 + offset % 512], inode);
+    inode->number = number;
+    return 0;
+}
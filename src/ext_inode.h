@@ -0,0 +1,55 @@
+#ifndef EXT_INODE_H
+#define EXT_INODE_H
+
+#include "pico/stdlib.h"
+#include "ext_volume.h"
+
+// Inode table sectors loaded per miss (4 KB = 16 inodes of 256 bytes).
+// Inodes of one directory are usually allocated together, so listing it
+// touches few windows.
+#define EXT_INODE_WINDOW_SECTORS 8
+
+#define EXT_ROOT_INODE 2
+
+// i_mode file types
+#define EXT_S_IFMT   0xF000
+#define EXT_S_IFSOCK 0xC000
+#define EXT_S_IFLNK  0xA000
+#define EXT_S_IFREG  0x8000
+#define EXT_S_IFBLK  0x6000
+#define EXT_S_IFDIR  0x4000
+#define EXT_S_IFCHR  0x2000
+#define EXT_S_IFIFO  0x1000
+
+// i_flags bits
+#define EXT_INODE_INDEX_FL       0x00001000     // Directory has an htree index
+#define EXT_INODE_HUGE_FILE_FL   0x00040000
+#define EXT_INODE_EXTENTS_FL     0x00080000
+#define EXT_INODE_INLINE_DATA_FL 0x10000000
+
+// Decoded inode; block holds i_block as stored (extent root, block
+// pointers, inline data or a fast symlink target)
+typedef struct {
+    uint32_t number;
+    uint16_t mode;
+    uint16_t links;
+    uint32_t uid;
+    uint32_t gid;
+    uint64_t size;
+    uint32_t atime;
+    uint32_t ctime;
+    uint32_t mtime;
+    uint32_t flags;
+    uint64_t sectors;           // i_blocks in 512-byte units
+    uint8_t block[60];
+} ext_inode_t;
+
+// Read inode number through the inode table window.
+// Returns 0, -4 for an inode number outside the volume, or a read error.
+int ext_inode_read(const ext_volume_t* vol, uint32_t number, ext_inode_t* inode);
+
+// Forget the window (after switching volumes)
+void ext_inode_cache_reset(void);
+void ext_inode_print_cache_stats(void);
+
+#endif // EXT_INODE_H
@@ -0,0 +1,183 @@
+#include "ext_path.h"
+#include "ext_file.h"
+#include <stdio.h>
+#include <string.h>
+
+// Path being resolved, rewritten in place when a symbolic link is followed
+static char path_buf[2][EXT_PATH_MAX];
+static ext_file_t path_file;
+
+int ext_path_resolve(const ext_volume_t* vol, const char* path, bool follow,
+                     ext_inode_t* inode, ext_dirent_t* ent) {
+    ext_inode_t dir;
+    uint32_t links = 0;
+    int current = 0;
+
+    if (strlen(path) >= EXT_PATH_MAX) {
+        return -7;
+    }
+    strcpy(path_buf[current], path);
+    const char* p = path_buf[current];
+
+    int result = ext_inode_read(vol, EXT_ROOT_INODE, inode);
+    if (result != 0) {
+        return result;
+    }
+    memset(ent, 0, sizeof(*ent));
+    strcpy(ent->name, "/");
+    ent->inode = EXT_ROOT_INODE;
+    ent->file_type = EXT_FT_DIR;
+
+    for (;;) {
+        while (*p == '/') p++;
+        if (*p == 0) break;
+
+        const char* end = p;
+        while (*end && *end != '/') end++;
+        const char* rest = end;
+        while (*rest == '/') rest++;
+
+        if ((inode->mode & EXT_S_IFMT) != EXT_S_IFDIR) {
+            return -6; // Path continues below a file
+        }
+
+        dir = *inode;
+        result = ext_dir_find(vol, &dir, p, end - p, ent);
+        if (result <= 0) {
+            return result < 0 ? result : -7; // Not found
+        }
+
+        result = ext_inode_read(vol, ent->inode, inode);
+        if (result != 0) {
+            return result;
+        }
+
+        bool last = (*rest == 0);
+        if ((inode->mode & EXT_S_IFMT) != EXT_S_IFLNK || (last && !follow)) {
+            p = end;
+            continue;
+        }
+
+        // Splice the link target in front of what is left of the path
+        if (++links > EXT_PATH_MAX_LINKS || inode->size == 0 ||
+            inode->size + 1 + strlen(rest) >= EXT_PATH_MAX) {
+            return -8;
+        }
+
+        int next = current ^ 1;
+        result = ext_file_open_inode(&path_file, vol, inode);
+        int32_t got = result == 0 ? ext_file_read(&path_file, 0, (uint8_t*)path_buf[next], (uint32_t)inode->size) : result;
+        if (got < 0) {
+            return got;
+        }
+        path_buf[next][got] = 0;
+        strcat(path_buf[next], "/");
+        strcat(path_buf[next], rest);
+        current = next;
+        p = path_buf[current];
+
+        // Absolute targets restart at the root, relative ones in the link's directory
+        if (*p == '/') {
+            result = ext_inode_read(vol, EXT_ROOT_INODE, inode);
+            if (result != 0) {
+                return result;
+            }
+        } else {
+            *inode = dir;
+        }
+    }
+
+    return 0;
+}
+
+int ext_path_print(const ext_volume_t* vol, const char* path) {
+    static ext_dirent_t ent;
+    ext_inode_t inode;
+
+    int result = ext_path_resolve(vol, path, false, &inode, &ent);
+    switch (result) {
+        case 0:
+            ext_dir_print_entry(vol, &ent, &inode);
+            break;
+        case -7:
+            printf("  %s: not found\n", path);
+            break;
+        case -6:
+            printf("  %s: not a directory\n", path);
+            break;
+        case -8:
+            printf("  %s: too many levels of symbolic links\n", path);
+            break;
+        default:
+            printf("  %s: lookup failed (error %d)\n", path, result);
+            break;
+    }
+
+    return result;
+}
+
+int ext_path_list(const ext_volume_t* vol, const char* path) {
+    static ext_dirent_t ent;
+    ext_inode_t inode;
+
+    int result = ext_path_resolve(vol, path, true, &inode, &ent);
+    if (result == 0) {
+        result = ext_dir_list(vol, &inode, path);
+    }
+
+    if (result != 0) {
+        printf("  Cannot list %s (error %d)\n", path, result);
+    }
+    return result;
+}
+
+int ext_path_cat(const ext_volume_t* vol, const char* path, uint32_t max_bytes) {
+    static ext_dirent_t ent;
+    static uint8_t chunk[512];
+    ext_inode_t inode;
+    uint64_t offset = 0;
+
+    int result = ext_path_resolve(vol, path, true, &inode, &ent);
+    if (result == 0 && (inode.mode & EXT_S_IFMT) != EXT_S_IFREG) {
+        result = -6;
+    }
+    if (result == 0) {
+        result = ext_file_open_inode(&path_file, vol, &inode);
+    }
+    if (result != 0) {
+        printf("  Cannot read %s (error %d)\n", path, result);
+        return result;
+    }
+
+    printf("\n  === %s (%llu bytes) ===\n", path, (unsigned long long)inode.size);
+
+    bool line_start = true;
+    while (offset < inode.size && offset < max_bytes) {
+        uint32_t want = sizeof(chunk);
+        if (want > max_bytes - offset) want = (uint32_t)(max_bytes - offset);
+
+        int32_t got = ext_file_read(&path_file, offset, chunk, want);
+        if (got <= 0) {
+            result = got < 0 ? got : -5;
+            break;
+        }
+
+        // Indent each line; bytes outside printable ASCII, other than tab, show as '.'
+        for (int32_t i = 0; i < got; i++) {
+            uint8_t c = chunk[i];
+            if (line_start) printf("  ");
+            line_start = (c == '\n');
+            putchar(c == '\n' || c == '\t' || (c >= 0x20 && c < 0x7F) ? c : '.');
+        }
+        offset += (uint32_t)got;
+    }
+
+    if (!line_start) printf("\n");
+    if (offset < inode.size) {
+        printf("  ... %llu more bytes\n", (unsigned long long)(inode.size - offset));
+    }
+    if (result != 0) {
+        printf("  Read failed (error %d)\n", result);
+    }
+    return result;
+}
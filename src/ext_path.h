@@ -0,0 +1,29 @@
+#ifndef EXT_PATH_H
+#define EXT_PATH_H
+
+#include "pico/stdlib.h"
+#include "ext_volume.h"
+#include "ext_inode.h"
+#include "ext_dir.h"
+
+// Symbolic links followed while resolving one path
+#define EXT_PATH_MAX_LINKS 8
+#define EXT_PATH_MAX       1024
+
+// Resolve an absolute path from the root inode. Symbolic links in the
+// middle of the path are followed; the last component is followed only
+// with follow set. Returns 0, -7 if a component does not exist, -6 if the
+// path continues below a file, -8 for too many links, or a read error.
+int ext_path_resolve(const ext_volume_t* vol, const char* path, bool follow,
+                     ext_inode_t* inode, ext_dirent_t* ent);
+
+// Print one path in 'ls -l' style, or why it could not be resolved
+int ext_path_print(const ext_volume_t* vol, const char* path);
+
+// 'ls -l' listing of the directory at path
+int ext_path_list(const ext_volume_t* vol, const char* path);
+
+// Print up to max_bytes of a file as text, for checking config files
+int ext_path_cat(const ext_volume_t* vol, const char* path, uint32_t max_bytes);
+
+#endif // EXT_PATH_H
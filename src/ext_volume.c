@@ -0,0 +1,428 @@
+#include "ext_volume.h"
+#include "partition_display.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <string.h>
+
+// Superblock (two sectors), then descriptor table chunks
+static uint8_t super_buf[1024];
+static uint8_t gdt_buf[EXT_GDT_CHUNK_SECTORS * 512];
+
+static uint16_t read_le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+typedef struct {
+    uint32_t bit;
+    const char* name;
+} ext_feature_name_t;
+
+static const ext_feature_name_t compat_names[] = {
+    {0x0001, "dir_prealloc"}, {0x0004, "has_journal"}, {0x0008, "ext_attr"},
+    {0x0010, "resize_inode"}, {0x0020, "dir_index"}, {0x0200, "sparse_super2"},
+    {0x0400, "fast_commit"}, {0x0800, "stable_inodes"}, {0, NULL}
+};
+
+static const ext_feature_name_t incompat_names[] = {
+    {0x0001, "compression"}, {0x0002, "filetype"}, {0x0004, "needs_recovery"},
+    {0x0008, "journal_dev"}, {0x0010, "meta_bg"}, {0x0040, "extent"},
+    {0x0080, "64bit"}, {0x0100, "mmp"}, {0x0200, "flex_bg"}, {0x0400, "ea_inode"},
+    {0x1000, "dirdata"}, {0x2000, "metadata_csum_seed"}, {0x4000, "large_dir"},
+    {0x8000, "inline_data"}, {0x10000, "encrypt"}, {0x20000, "casefold"}, {0, NULL}
+};
+
+static const ext_feature_name_t ro_compat_names[] = {
+    {0x0001, "sparse_super"}, {0x0002, "large_file"}, {0x0008, "huge_file"},
+    {0x0010, "uninit_bg"}, {0x0020, "dir_nlink"}, {0x0040, "extra_isize"},
+    {0x0100, "quota"}, {0x0200, "bigalloc"}, {0x0400, "metadata_csum"},
+    {0x1000, "read-only"}, {0x2000, "project"}, {0x8000, "verity"}, {0, NULL}
+};
+
+static void print_features(uint32_t bits, const ext_feature_name_t* names) {
+    for (const ext_feature_name_t* f = names; f->name; f++) {
+        if (bits & f->bit) {
+            printf(" %s", f->name);
+            bits &= ~f->bit;
+        }
+    }
+    if (bits) {
+        printf(" (unknown 0x%x)", bits);
+    }
+}
+
+static bool is_power_of_two(uint32_t v) {
+    return v != 0 && (v & (v - 1)) == 0;
+}
+
+int ext_volume_mount(ext_volume_t* vol, uint32_t start_lba) {
+    memset(vol, 0, sizeof(*vol));
+    vol->start_lba = start_lba;
+
+    if (sd_read_blocks(start_lba + EXT_SUPERBLOCK_OFFSET / 512, 2, super_buf) != 0) {
+        return -1;
+    }
+
+    const uint8_t* sb = super_buf;
+    if (read_le16(&sb[56]) != EXT_MAGIC) {
+        return -2;
+    }
+
+    uint32_t log_block_size = read_le32(&sb[24]);
+    if (log_block_size > 6) {
+        return -3; // Blocks above 64 KB
+    }
+
+    vol->block_size = 1024u << log_block_size;
+    vol->sectors_per_block = vol->block_size / 512;
+    vol->inodes_count = read_le32(&sb[0]);
+    vol->free_inodes = read_le32(&sb[16]);
+    vol->first_data_block = read_le32(&sb[20]);
+    vol->blocks_per_group = read_le32(&sb[32]);
+    vol->inodes_per_group = read_le32(&sb[40]);
+    vol->mount_count = read_le16(&sb[52]);
+    vol->max_mount_count = (int16_t)read_le16(&sb[54]);
+    vol->state = read_le16(&sb[58]);
+    vol->rev_level = read_le32(&sb[76]);
+    vol->inode_size = vol->rev_level >= 1 ? read_le16(&sb[88]) : 128;
+    vol->feature_compat = read_le32(&sb[92]);
+    vol->feature_incompat = read_le32(&sb[96]);
+    vol->feature_ro_compat = read_le32(&sb[100]);
+    memcpy(vol->uuid, &sb[104], 16);
+    memcpy(vol->volume_name, &sb[120], 16);
+    memcpy(vol->last_mounted, &sb[136], 64);
+    for (int i = 0; i < 4; i++) {
+        vol->hash_seed[i] = read_le32(&sb[236 + i * 4]);
+    }
+    vol->def_hash_version = sb[252];
+    vol->first_meta_bg = read_le32(&sb[260]);
+    vol->backup_bgs[0] = read_le32(&sb[588]);
+    vol->backup_bgs[1] = read_le32(&sb[592]);
+    vol->flags = read_le32(&sb[352]);
+
+    // Counts above 32 bits only exist on 64bit volumes
+    bool wide = (vol->feature_incompat & EXT_INCOMPAT_64BIT) != 0;
+    vol->blocks_count = read_le32(&sb[4]) | (wide ? (uint64_t)read_le32(&sb[336]) << 32 : 0);
+    vol->reserved_blocks = read_le32(&sb[8]) | (wide ? (uint64_t)read_le32(&sb[340]) << 32 : 0);
+    vol->free_blocks = read_le32(&sb[12]) | (wide ? (uint64_t)read_le32(&sb[344]) << 32 : 0);
+    vol->desc_size = wide ? read_le16(&sb[254]) : 32;
+
+    vol->groups_per_flex = 1;
+    if ((vol->feature_incompat & EXT_INCOMPAT_FLEX_BG) && sb[372] < 31) {
+        vol->groups_per_flex = 1u << sb[372];
+    }
+
+    if (vol->blocks_per_group == 0 || vol->blocks_per_group > vol->block_size * 8 ||
+        vol->inodes_per_group == 0 || vol->inodes_per_group > vol->block_size * 8 ||
+        vol->blocks_count <= vol->first_data_block) {
+        return -3;
+    }
+
+    if (!is_power_of_two(vol->inode_size) || vol->inode_size < 128 || vol->inode_size > vol->block_size) {
+        return -3;
+    }
+
+    // Descriptors must not straddle sectors for the streamed table read
+    if (!is_power_of_two(vol->desc_size) || vol->desc_size < 32 || vol->desc_size > 512) {
+        return -3;
+    }
+
+    uint64_t groups = (vol->blocks_count - vol->first_data_block + vol->blocks_per_group - 1) /
+                      vol->blocks_per_group;
+    if (groups == 0 || groups > UINT32_MAX || (uint64_t)vol->inodes_per_group * groups > UINT32_MAX) {
+        return -3;
+    }
+
+    vol->group_count = (uint32_t)groups;
+    vol->descs_per_block = vol->block_size / vol->desc_size;
+
+    return 0;
+}
+
+const char* ext_volume_kind(const ext_volume_t* vol) {
+    const uint32_t ext4_incompat = EXT_INCOMPAT_EXTENTS | EXT_INCOMPAT_64BIT | EXT_INCOMPAT_FLEX_BG |
+                                   EXT_INCOMPAT_MMP | EXT_INCOMPAT_INLINE_DATA;
+    const uint32_t ext4_ro_compat = EXT_RO_COMPAT_HUGE_FILE | EXT_RO_COMPAT_GDT_CSUM |
+                                    EXT_RO_COMPAT_DIR_NLINK | EXT_RO_COMPAT_EXTRA_ISIZE |
+                                    EXT_RO_COMPAT_METADATA_CSUM;
+
+    if ((vol->feature_incompat & ext4_incompat) || (vol->feature_ro_compat & ext4_ro_compat)) {
+        return "ext4";
+    }
+    if (vol->feature_compat & EXT_COMPAT_HAS_JOURNAL) {
+        return "ext3";
+    }
+    return "ext2";
+}
+
+uint32_t ext_volume_block_to_lba(const ext_volume_t* vol, uint64_t block) {
+    return vol->start_lba + (uint32_t)(block * vol->sectors_per_block);
+}
+
+int ext_volume_read_blocks(const ext_volume_t* vol, uint64_t block, uint32_t count, uint8_t* buffer) {
+    if (block + count > vol->blocks_count) {
+        return -4; // Outside the volume
+    }
+
+    if (sd_read_blocks(ext_volume_block_to_lba(vol, block), count * vol->sectors_per_block, buffer) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Groups carrying a superblock backup, and with it a descriptor table copy
+static bool ext_group_has_super(const ext_volume_t* vol, uint32_t group) {
+    if (group == 0) {
+        return true;
+    }
+
+    // sparse_super2 keeps at most two backups, in the groups it names
+    if (vol->feature_compat & EXT_COMPAT_SPARSE_SUPER2) {
+        return group == vol->backup_bgs[0] || group == vol->backup_bgs[1];
+    }
+
+    if (group == 1 || !(vol->feature_ro_compat & EXT_RO_COMPAT_SPARSE_SUPER)) {
+        return true;
+    }
+
+    // Powers of 3, 5 and 7
+    for (uint32_t base = 3; base <= 7; base += 2) {
+        uint64_t power = base;
+        while (power < group) power *= base;
+        if (power == group) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Block holding descriptor block index of the table. With meta_bg the
+// table past first_meta_bg is split up, one block at the start of each
+// meta group (the groups one descriptor block covers).
+static uint64_t ext_desc_block(const ext_volume_t* vol, uint32_t index) {
+    if (!(vol->feature_incompat & EXT_INCOMPAT_META_BG) || index < vol->first_meta_bg) {
+        return (uint64_t)vol->first_data_block + 1 + index;
+    }
+
+    uint32_t group = index * vol->descs_per_block;
+    uint64_t first = vol->first_data_block + (uint64_t)group * vol->blocks_per_group;
+    return first + (ext_group_has_super(vol, group) ? 1 : 0);
+}
+
+static void ext_decode_group(const ext_volume_t* vol, const uint8_t* raw, ext_group_t* desc) {
+    bool wide = vol->desc_size >= 64;
+
+    desc->block_bitmap = read_le32(&raw[0]) | (wide ? (uint64_t)read_le32(&raw[32]) << 32 : 0);
+    desc->inode_bitmap = read_le32(&raw[4]) | (wide ? (uint64_t)read_le32(&raw[36]) << 32 : 0);
+    desc->inode_table = read_le32(&raw[8]) | (wide ? (uint64_t)read_le32(&raw[40]) << 32 : 0);
+    desc->free_blocks = read_le16(&raw[12]) | (wide ? (uint32_t)read_le16(&raw[44]) << 16 : 0);
+    desc->free_inodes = read_le16(&raw[14]) | (wide ? (uint32_t)read_le16(&raw[46]) << 16 : 0);
+    desc->used_dirs = read_le16(&raw[16]) | (wide ? (uint32_t)read_le16(&raw[48]) << 16 : 0);
+    desc->flags = read_le16(&raw[18]);
+    desc->itable_unused = read_le16(&raw[28]) | (wide ? (uint32_t)read_le16(&raw[50]) << 16 : 0);
+}
+
+int ext_volume_read_group(const ext_volume_t* vol, uint32_t group, ext_group_t* desc) {
+    static uint8_t sector[512];
+
+    if (group >= vol->group_count) {
+        return -4;
+    }
+
+    uint32_t offset = (group % vol->descs_per_block) * vol->desc_size;
+    uint32_t lba = ext_volume_block_to_lba(vol, ext_desc_block(vol, group / vol->descs_per_block)) + offset / 512;
+    if (sd_read_block(lba, sector) != 0) {
+        return -1;
+    }
+
+    ext_decode_group(vol, &sector[offset % 512], desc);
+    return 0;
+}
+
+static void ext_account_group(const ext_volume_t* vol, uint32_t group, const ext_group_t* desc,
+                              ext_groups_report_t* report) {
+    uint64_t first = vol->first_data_block + (uint64_t)group * vol->blocks_per_group;
+    uint64_t itable_blocks = ((uint64_t)vol->inodes_per_group * vol->inode_size + vol->block_size - 1) /
+                             vol->block_size;
+
+    report->free_blocks += desc->free_blocks;
+    report->free_inodes += desc->free_inodes;
+    report->used_dirs += desc->used_dirs;
+    if (desc->flags & EXT_BG_BLOCK_UNINIT) report->block_uninit++;
+    if (desc->flags & EXT_BG_INODE_UNINIT) report->inode_uninit++;
+    if ((vol->feature_ro_compat & (EXT_RO_COMPAT_GDT_CSUM | EXT_RO_COMPAT_METADATA_CSUM)) &&
+        !(desc->flags & EXT_BG_INODE_ZEROED)) {
+        report->itable_unzeroed++;
+    }
+
+    if (desc->block_bitmap >= vol->blocks_count || desc->inode_bitmap >= vol->blocks_count ||
+        desc->inode_table + itable_blocks > vol->blocks_count) {
+        report->bad_locations++;
+    } else if (desc->inode_table < first || desc->inode_table >= first + vol->blocks_per_group) {
+        report->foreign_metadata++;
+    }
+
+    if (group < EXT_PRINT_GROUPS) {
+        report->first[group] = *desc;
+    }
+}
+
+int ext_volume_scan_groups(const ext_volume_t* vol, ext_groups_report_t* report) {
+    uint32_t desc_blocks = (vol->group_count + vol->descs_per_block - 1) / vol->descs_per_block;
+    uint32_t descs_per_sector = 512 / vol->desc_size;
+    uint32_t group = 0;
+    uint32_t index = 0;
+    ext_group_t desc;
+
+    memset(report, 0, sizeof(*report));
+    uint64_t start_us = time_us_64();
+
+    while (group < vol->group_count) {
+        // Run of descriptor blocks that follow each other on disk
+        uint64_t first = ext_desc_block(vol, index);
+        uint32_t run = 1;
+        while (index + run < desc_blocks && ext_desc_block(vol, index + run) == first + run) {
+            run++;
+        }
+
+        if (first + run > vol->blocks_count) {
+            return -4;
+        }
+
+        // Only the sectors holding descriptors of existing groups
+        uint32_t groups_left = vol->group_count - group;
+        uint64_t run_groups = (uint64_t)run * vol->descs_per_block;
+        if (run_groups > groups_left) run_groups = groups_left;
+        uint32_t sectors_left = (uint32_t)((run_groups + descs_per_sector - 1) / descs_per_sector);
+        uint32_t lba = ext_volume_block_to_lba(vol, first);
+
+        while (sectors_left > 0) {
+            uint32_t chunk = sectors_left < EXT_GDT_CHUNK_SECTORS ? sectors_left : EXT_GDT_CHUNK_SECTORS;
+            if (sd_read_blocks(lba, chunk, gdt_buf) != 0) {
+                return -1;
+            }
+            report->reads++;
+
+            for (uint32_t i = 0; i < chunk * descs_per_sector && group < vol->group_count; i++) {
+                ext_decode_group(vol, &gdt_buf[i * vol->desc_size], &desc);
+                ext_account_group(vol, group, &desc, report);
+                group++;
+            }
+
+            lba += chunk;
+            sectors_left -= chunk;
+        }
+
+        index += run;
+    }
+
+    report->scan_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+    return 0;
+}
+
+void ext_volume_print_info(const ext_volume_t* vol) {
+    char size_str[32];
+    char free_str[32];
+    const uint8_t* u = vol->uuid;
+
+    partition_display_format_size(vol->blocks_count * vol->block_size, size_str, sizeof(size_str));
+    partition_display_format_size(vol->free_blocks * vol->block_size, free_str, sizeof(free_str));
+
+    printf("\n  === %s volume ===\n", ext_volume_kind(vol));
+    if (vol->volume_name[0]) {
+        printf("  Label: %s\n", vol->volume_name);
+    }
+    printf("  UUID: %02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x\n",
+           u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7],
+           u[8], u[9], u[10], u[11], u[12], u[13], u[14], u[15]);
+    printf("  Size: %s, %llu blocks of %u bytes, %u groups of %u blocks\n",
+           size_str, (unsigned long long)vol->blocks_count, vol->block_size,
+           vol->group_count, vol->blocks_per_group);
+    printf("  Free (superblock): %s, %llu blocks (%llu reserved)\n",
+           free_str, (unsigned long long)vol->free_blocks, (unsigned long long)vol->reserved_blocks);
+    printf("  Inodes: %u total, %u free, %u bytes each, %u per group\n",
+           vol->inodes_count, vol->free_inodes, vol->inode_size, vol->inodes_per_group);
+    printf("  Group descriptors: %u bytes", vol->desc_size);
+    if (vol->groups_per_flex > 1) {
+        printf(", flex groups of %u", vol->groups_per_flex);
+    }
+    if (vol->feature_incompat & EXT_INCOMPAT_META_BG) {
+        printf(", meta_bg from descriptor block %u", vol->first_meta_bg);
+    }
+    printf("\n");
+
+    printf("  Features:");
+    print_features(vol->feature_compat, compat_names);
+    print_features(vol->feature_incompat, incompat_names);
+    print_features(vol->feature_ro_compat, ro_compat_names);
+    printf("\n");
+
+    if (vol->last_mounted[0]) {
+        printf("  Last mounted on: %s\n", vol->last_mounted);
+    }
+    printf("  Mount count: %u", vol->mount_count);
+    if (vol->max_mount_count > 0) {
+        printf(" of %d before a check", vol->max_mount_count);
+    }
+    printf("\n");
+
+    // State bit 0: cleanly unmounted, bit 1: errors detected
+    if (!(vol->state & 0x0001)) {
+        printf("  Volume was not cleanly unmounted\n");
+    }
+    if (vol->state & 0x0002) {
+        printf("  Volume has recorded errors\n");
+    }
+    if (vol->feature_incompat & EXT_INCOMPAT_RECOVER) {
+        printf("  Journal needs recovery; recent changes may not be visible\n");
+    }
+}
+
+void ext_volume_print_groups(const ext_volume_t* vol, const ext_groups_report_t* report) {
+    char free_str[32];
+
+    partition_display_format_size(report->free_blocks * vol->block_size, free_str, sizeof(free_str));
+
+    printf("\n  === Block groups ===\n");
+    printf("  Group  Block bmp   Inode bmp   Inode table  Free blk  Free ino  Dirs  Flags\n");
+
+    uint32_t shown = vol->group_count < EXT_PRINT_GROUPS ? vol->group_count : EXT_PRINT_GROUPS;
+    for (uint32_t g = 0; g < shown; g++) {
+        const ext_group_t* d = &report->first[g];
+        printf("  %5u  %10llu  %10llu  %11llu  %8u  %8u  %4u  %s%s%s\n",
+               g, (unsigned long long)d->block_bitmap, (unsigned long long)d->inode_bitmap,
+               (unsigned long long)d->inode_table, d->free_blocks, d->free_inodes, d->used_dirs,
+               (d->flags & EXT_BG_INODE_UNINIT) ? "I" : "-",
+               (d->flags & EXT_BG_BLOCK_UNINIT) ? "B" : "-",
+               (d->flags & EXT_BG_INODE_ZEROED) ? "Z" : "-");
+    }
+    if (vol->group_count > shown) {
+        printf("  ... %u more groups\n", vol->group_count - shown);
+    }
+
+    printf("  Free: %s, %llu blocks and %llu inodes; %u directories\n",
+           free_str, (unsigned long long)report->free_blocks,
+           (unsigned long long)report->free_inodes, report->used_dirs);
+    printf("  Uninitialised: %u block bitmaps, %u inode tables", report->block_uninit, report->inode_uninit);
+    if (report->itable_unzeroed > 0) {
+        printf(", %u inode tables not yet zeroed", report->itable_unzeroed);
+    }
+    printf("\n");
+    if (vol->groups_per_flex > 1) {
+        printf("  %u groups keep their inode table in another group of their flex group\n",
+               report->foreign_metadata);
+    }
+    printf("  Descriptor table read in %u transfers, %u ms\n", report->reads, report->scan_ms);
+
+    // The superblock counters are only refreshed at unmount or fsck
+    if (report->free_blocks != vol->free_blocks || report->free_inodes != vol->free_inodes) {
+        printf("  Superblock says %llu free blocks and %u free inodes\n",
+               (unsigned long long)vol->free_blocks, vol->free_inodes);
+    }
+    if (report->bad_locations > 0) {
+        printf("  %u groups point outside the volume\n", report->bad_locations);
+    }
+}
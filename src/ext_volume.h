@@ -0,0 +1,136 @@
+#ifndef EXT_VOLUME_H
+#define EXT_VOLUME_H
+
+#include "pico/stdlib.h"
+
+// The superblock sits 1024 bytes into the partition whatever the block size
+#define EXT_SUPERBLOCK_OFFSET 1024
+#define EXT_MAGIC             0xEF53
+
+// Descriptor table sectors fetched per multi-block read (16 KB = 256 groups
+// of 64-byte descriptors, a 32 GB card with 4 KB blocks)
+#define EXT_GDT_CHUNK_SECTORS 32
+
+// Groups listed one per line by ext_volume_print_groups()
+#define EXT_PRINT_GROUPS 8
+
+// feature_compat bits
+#define EXT_COMPAT_HAS_JOURNAL    0x0004
+#define EXT_COMPAT_EXT_ATTR       0x0008
+#define EXT_COMPAT_RESIZE_INODE   0x0010
+#define EXT_COMPAT_DIR_INDEX      0x0020
+#define EXT_COMPAT_SPARSE_SUPER2  0x0200
+
+// feature_incompat bits
+#define EXT_INCOMPAT_FILETYPE     0x0002
+#define EXT_INCOMPAT_RECOVER      0x0004
+#define EXT_INCOMPAT_JOURNAL_DEV  0x0008
+#define EXT_INCOMPAT_META_BG      0x0010
+#define EXT_INCOMPAT_EXTENTS      0x0040
+#define EXT_INCOMPAT_64BIT        0x0080
+#define EXT_INCOMPAT_MMP          0x0100
+#define EXT_INCOMPAT_FLEX_BG      0x0200
+#define EXT_INCOMPAT_CSUM_SEED    0x2000
+#define EXT_INCOMPAT_LARGEDIR     0x4000
+#define EXT_INCOMPAT_INLINE_DATA  0x8000
+
+// feature_ro_compat bits
+#define EXT_RO_COMPAT_SPARSE_SUPER  0x0001
+#define EXT_RO_COMPAT_LARGE_FILE    0x0002
+#define EXT_RO_COMPAT_HUGE_FILE     0x0008
+#define EXT_RO_COMPAT_GDT_CSUM      0x0010
+#define EXT_RO_COMPAT_DIR_NLINK     0x0020
+#define EXT_RO_COMPAT_EXTRA_ISIZE   0x0040
+#define EXT_RO_COMPAT_QUOTA         0x0100
+#define EXT_RO_COMPAT_METADATA_CSUM 0x0400
+
+// Superblock s_flags: directory hashes use unsigned chars
+#define EXT_FLAGS_UNSIGNED_HASH 0x0002
+
+// Block group flags
+#define EXT_BG_INODE_UNINIT 0x0001
+#define EXT_BG_BLOCK_UNINIT 0x0002
+#define EXT_BG_INODE_ZEROED 0x0004
+
+// Geometry and metadata of a mounted ext2/3/4 volume
+typedef struct {
+    uint32_t start_lba;
+    uint32_t block_size;
+    uint32_t sectors_per_block;
+    uint64_t blocks_count;
+    uint64_t reserved_blocks;
+    uint64_t free_blocks;       // As recorded in the superblock
+    uint32_t inodes_count;
+    uint32_t free_inodes;
+    uint32_t first_data_block;  // 1 with 1 KB blocks, else 0
+    uint32_t blocks_per_group;
+    uint32_t inodes_per_group;
+    uint32_t group_count;
+    uint16_t inode_size;
+    uint16_t desc_size;         // 32, or up to 64 with the 64bit feature
+    uint32_t descs_per_block;
+    uint32_t first_meta_bg;
+    uint32_t backup_bgs[2];     // Groups holding backup superblocks with sparse_super2
+    uint32_t groups_per_flex;   // 1 without flex_bg
+    uint32_t rev_level;
+    uint32_t feature_compat;
+    uint32_t feature_incompat;
+    uint32_t feature_ro_compat;
+    uint16_t state;
+    uint16_t mount_count;
+    int16_t max_mount_count;
+    uint32_t flags;             // s_flags: EXT_FLAGS_UNSIGNED_HASH
+    uint32_t hash_seed[4];
+    uint8_t def_hash_version;
+    uint8_t uuid[16];
+    char volume_name[17];
+    char last_mounted[65];
+} ext_volume_t;
+
+// One decoded block group descriptor
+typedef struct {
+    uint64_t block_bitmap;
+    uint64_t inode_bitmap;
+    uint64_t inode_table;
+    uint32_t free_blocks;
+    uint32_t free_inodes;
+    uint32_t used_dirs;
+    uint32_t itable_unused;
+    uint16_t flags;
+} ext_group_t;
+
+// Totals over the whole descriptor table
+typedef struct {
+    uint64_t free_blocks;
+    uint64_t free_inodes;
+    uint32_t used_dirs;
+    uint32_t block_uninit;      // Groups whose block bitmap was never written
+    uint32_t inode_uninit;
+    uint32_t itable_unzeroed;   // Inode tables not yet zeroed by the kernel
+    uint32_t foreign_metadata;  // Groups whose inode table lives in another group (flex_bg)
+    uint32_t bad_locations;     // Bitmaps or inode tables outside the volume
+    uint32_t reads;             // Multi-block reads issued for the table
+    uint32_t scan_ms;
+    ext_group_t first[EXT_PRINT_GROUPS];    // Leading groups, for the listing
+} ext_groups_report_t;
+
+// Read and check the superblock; 0, -1 read error, -2 not ext, -3 bad geometry
+int ext_volume_mount(ext_volume_t* vol, uint32_t start_lba);
+void ext_volume_print_info(const ext_volume_t* vol);
+
+// "ext2", "ext3" or "ext4", from the features in use
+const char* ext_volume_kind(const ext_volume_t* vol);
+
+uint32_t ext_volume_block_to_lba(const ext_volume_t* vol, uint64_t block);
+
+// Read count whole blocks with one multi-block transfer
+int ext_volume_read_blocks(const ext_volume_t* vol, uint64_t block, uint32_t count, uint8_t* buffer);
+
+// Descriptor of one group, read through a single sector
+int ext_volume_read_group(const ext_volume_t* vol, uint32_t group, ext_group_t* desc);
+
+// Stream the whole descriptor table, one multi-block read per contiguous run
+int ext_volume_scan_groups(const ext_volume_t* vol, ext_groups_report_t* report);
+void ext_volume_print_groups(const ext_volume_t* vol, const ext_groups_report_t* report);
+
+#endif // EXT_VOLUME_H
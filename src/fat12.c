@@ -0,0 +1,105 @@
+#include "fat12.h"
+#include "sd_block.h"
+
+// Packed chunk and its decoded entries; two bytes of carry can add a group
+static uint8_t fat12_chunk[FAT12_CHUNK_SECTORS * 512];
+static uint32_t fat12_words[(FAT12_CHUNK_SECTORS * 512 + 2) / 3 + 1];
+
+void fat12_decoder_reset(fat12_decoder_t* dec) {
+    dec->carry_bytes = 0;
+}
+
+static inline uint32_t fat12_unpack_group(uint32_t b0, uint32_t b1, uint32_t b2) {
+    uint32_t group = b0 | (b1 << 8) | (b2 << 16);
+    return (group & 0xFFF) | ((group >> 12) << 16);
+}
+
+uint32_t fat12_decode(fat12_decoder_t* dec, const uint8_t* bytes, uint32_t length, uint32_t* words) {
+    uint32_t count = 0;
+
+    // Complete the group left open by the previous buffer
+    if (dec->carry_bytes > 0) {
+        uint32_t need = 3 - dec->carry_bytes;
+        if (length < need) {
+            for (uint32_t i = 0; i < length; i++) {
+                dec->carry[dec->carry_bytes++] = bytes[i];
+            }
+            return 0;
+        }
+
+        if (dec->carry_bytes == 2) {
+            words[count++] = fat12_unpack_group(dec->carry[0], dec->carry[1], bytes[0]);
+        } else {
+            words[count++] = fat12_unpack_group(dec->carry[0], bytes[0], bytes[1]);
+        }
+        bytes += need;
+        length -= need;
+        dec->carry_bytes = 0;
+    }
+
+    // Four groups per iteration: 12 bytes become four words
+    while (length >= 12) {
+        words[count + 0] = fat12_unpack_group(bytes[0], bytes[1], bytes[2]);
+        words[count + 1] = fat12_unpack_group(bytes[3], bytes[4], bytes[5]);
+        words[count + 2] = fat12_unpack_group(bytes[6], bytes[7], bytes[8]);
+        words[count + 3] = fat12_unpack_group(bytes[9], bytes[10], bytes[11]);
+        count += 4;
+        bytes += 12;
+        length -= 12;
+    }
+
+    while (length >= 3) {
+        words[count++] = fat12_unpack_group(bytes[0], bytes[1], bytes[2]);
+        bytes += 3;
+        length -= 3;
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        dec->carry[dec->carry_bytes++] = bytes[i];
+    }
+
+    return count;
+}
+
+int fat12_stream(fat_volume_t* vol, fat12_visit_t visit, void* ctx) {
+    fat12_decoder_t dec;
+    uint32_t entry_count = vol->cluster_count + 2;
+    uint32_t fat_sectors = vol->fat_entry_sectors;
+    uint32_t entry = 0;
+
+    fat12_decoder_reset(&dec);
+
+    for (uint32_t sector = 0; sector < fat_sectors && entry < entry_count; sector += FAT12_CHUNK_SECTORS) {
+        uint32_t chunk = fat_sectors - sector;
+        if (chunk > FAT12_CHUNK_SECTORS) chunk = FAT12_CHUNK_SECTORS;
+
+        if (sd_read_blocks(vol->fat_lba + sector, chunk, fat12_chunk) != 0) {
+            return -1;
+        }
+
+        uint32_t words = fat12_decode(&dec, fat12_chunk, chunk * 512, fat12_words);
+        uint32_t entries = words * 2;
+        if (entries > entry_count - entry) entries = entry_count - entry;
+        if (entries == 0) continue;
+
+        int result = visit(fat12_words, entry, entries, ctx);
+        if (result != 0) {
+            return result;
+        }
+        entry += entries;
+    }
+
+    // An odd last entry needs only two bytes of its group, which may be the
+    // last two bytes of the FAT
+    if (entry + 1 == entry_count && dec.carry_bytes == 2) {
+        fat12_words[0] = fat12_unpack_group(dec.carry[0], dec.carry[1], 0);
+        int result = visit(fat12_words, entry, 1, ctx);
+        if (result != 0) {
+            return result;
+        }
+        entry++;
+    }
+
+    // A FAT shorter than its cluster count is corrupt
+    return (entry < entry_count) ? -2 : 0;
+}
@@ -0,0 +1,33 @@
+#ifndef FAT12_H
+#define FAT12_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+
+// FAT sectors fetched per multi-block read; a whole FAT12 is at most 12
+#define FAT12_CHUNK_SECTORS 4
+
+// FAT12 packs two 12-bit entries into every 3-byte group, so groups and
+// entries straddle sector and chunk boundaries. Bytes of a group left
+// incomplete at the end of one buffer are carried into the next.
+typedef struct {
+    uint8_t carry[2];
+    uint8_t carry_bytes;
+} fat12_decoder_t;
+
+void fat12_decoder_reset(fat12_decoder_t* dec);
+
+// Unpack whole 3-byte groups into words holding two entries each, entry
+// 2n in the low and 2n+1 in the high 16 bits (the FAT16 lane layout), so
+// FAT16 word scanners run on the result unchanged. Returns words written;
+// words must have room for (length + 2) / 3.
+uint32_t fat12_decode(fat12_decoder_t* dec, const uint8_t* bytes, uint32_t length, uint32_t* words);
+
+// Called with consecutive runs of decoded entries. The last run may end in
+// a half-filled word when the entry count is odd.
+typedef int (*fat12_visit_t)(uint32_t* words, uint32_t first_entry, uint32_t entries, void* ctx);
+
+// Stream FAT #1 of a FAT12 volume through the decoder in one pass
+int fat12_stream(fat_volume_t* vol, fat12_visit_t visit, void* ctx);
+
+#endif // FAT12_H
@@ -0,0 +1,369 @@
+#include "fat_check.h"
+#include "fat_walk.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define FAT_CHECK_WINDOW_CLUSTERS (FAT_CHECK_BITMAP_BYTES * 8)
+
+// FAT copy comparison reads each copy in chunks of half the bitmap
+#define FAT_CHECK_COPY_CHUNK_SECTORS (FAT_CHECK_BITMAP_BYTES / 2 / 512)
+
+// Clusters of the current window referenced by some chain
+static uint32_t check_bitmap[FAT_CHECK_BITMAP_BYTES / 4];
+
+typedef struct {
+    fat_volume_t* vol;
+    fat_check_report_t* report;
+    uint32_t window_start;      // First cluster tracked by the bitmap
+    uint32_t window_end;
+    bool first_pass;            // Per-chain checks are only reported once
+    bool tracked;               // Bitmap holds the window's chains (lost clusters can be told)
+} fat_check_ctx_t;
+
+static void fat_check_problem(fat_check_report_t* report, const char* fmt, ...) {
+    if (report->messages++ >= FAT_CHECK_MAX_MESSAGES) {
+        if (report->messages == FAT_CHECK_MAX_MESSAGES + 1) {
+            printf("  ... further problems are counted only\n");
+        }
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    printf("  ");
+    vprintf(fmt, args);
+    printf("\n");
+    va_end(args);
+}
+
+// Set the cluster's bit; returns true when it was already set
+static bool fat_check_mark(fat_check_ctx_t* c, uint32_t cluster) {
+    if (cluster < c->window_start || cluster >= c->window_end) {
+        return false;
+    }
+
+    uint32_t bit = cluster - c->window_start;
+    uint32_t mask = 1u << (bit & 31);
+    bool seen = (check_bitmap[bit >> 5] & mask) != 0;
+    check_bitmap[bit >> 5] |= mask;
+    return seen;
+}
+
+// Follow one chain, marking its clusters. expected is the cluster count
+// the file size calls for, or UINT32_MAX for directories.
+static void fat_check_chain(fat_check_ctx_t* c, const char* dir, const char* name,
+                            uint32_t first_cluster, uint32_t expected) {
+    fat_volume_t* vol = c->vol;
+    fat_check_report_t* report = c->report;
+    const char* sep = (strcmp(dir, "/") == 0 || name[0] == 0) ? "" : "/";
+    uint32_t cluster = first_cluster;
+    uint32_t length = 0;
+    uint32_t collision = 0;
+    int result = 0;
+
+    if (first_cluster == 0) {
+        if (c->first_pass && expected != UINT32_MAX && expected > 0) {
+            report->short_chains++;
+            fat_check_problem(report, "%s%s%s: no clusters for %u needed", dir, sep, name, expected);
+        }
+        return;
+    }
+
+    if (!fat_volume_is_data_cluster(vol, cluster)) {
+        if (c->first_pass) {
+            report->broken_chains++;
+            fat_check_problem(report, "%s%s%s: invalid first cluster %u", dir, sep, name, cluster);
+        }
+        return;
+    }
+
+    for (;;) {
+        if (++length > vol->cluster_count) {
+            break; // Longer than the volume: the chain loops
+        }
+
+        // Keep going after a collision so a loop can be told from a cross-link
+        if (fat_check_mark(c, cluster) && collision == 0) {
+            collision = cluster;
+        }
+
+        uint32_t next;
+        result = fat_volume_next_cluster(vol, cluster, &next);
+        if (result <= 0) {
+            break;
+        }
+        cluster = next;
+    }
+
+    if (length > vol->cluster_count) {
+        if (c->first_pass) {
+            report->looped_chains++;
+            fat_check_problem(report, "%s%s%s: cluster chain loops", dir, sep, name);
+        }
+        return;
+    }
+
+    if (collision != 0) {
+        report->cross_linked_chains++;
+        fat_check_problem(report, "%s%s%s: cross-linked at cluster %u", dir, sep, name, collision);
+    }
+
+    if (!c->first_pass) {
+        return;
+    }
+
+    if (result < 0) {
+        report->broken_chains++;
+        fat_check_problem(report, "%s%s%s: chain broken after cluster %u", dir, sep, name, cluster);
+    } else if (expected != UINT32_MAX && length < expected) {
+        report->short_chains++;
+        fat_check_problem(report, "%s%s%s: %u clusters, size needs %u", dir, sep, name, length, expected);
+    } else if (expected != UINT32_MAX && length > expected) {
+        report->long_chains++;
+        fat_check_problem(report, "%s%s%s: %u clusters, size needs %u", dir, sep, name, length, expected);
+    }
+}
+
+static void fat_check_entry(const char* path, const fat_dirent_t* ent, void* ctx) {
+    fat_check_ctx_t* c = ctx;
+    uint32_t cluster_bytes = fat_volume_cluster_bytes(c->vol);
+
+    // Subdirectory chains are checked here rather than on entry, so that
+    // directories the walker declines to descend into are still accounted
+    if (ent->attributes & FAT_ATTR_DIRECTORY) {
+        if (c->first_pass) c->report->dirs++;
+        fat_check_chain(c, path, ent->name, ent->first_cluster, UINT32_MAX);
+    } else {
+        if (c->first_pass) c->report->files++;
+        uint32_t expected = (uint32_t)(((uint64_t)ent->size + cluster_bytes - 1) / cluster_bytes);
+        fat_check_chain(c, path, ent->name, ent->first_cluster, expected);
+    }
+}
+
+// Stream the window's FAT entries once, looking for allocated clusters no
+// chain reached and for values that are not valid FAT entries
+static int fat_check_scan_fat(fat_check_ctx_t* c) {
+    fat_volume_t* vol = c->vol;
+    fat_check_report_t* report = c->report;
+
+    for (uint32_t cluster = c->window_start; cluster < c->window_end; cluster++) {
+        uint32_t value;
+        if (fat_volume_get_entry(vol, cluster, &value) != 0) {
+            return -1;
+        }
+
+        if (value == 0) {
+            continue;
+        }
+
+        if (fat_volume_is_bad_cluster(vol, value)) {
+            report->bad_clusters++;
+            continue;
+        }
+
+        bool end = fat_volume_is_end_of_chain(vol, value);
+        if (!end && !fat_volume_is_data_cluster(vol, value)) {
+            report->invalid_entries++;
+            fat_check_problem(report, "FAT entry %u holds invalid value 0x%08x", cluster, value);
+        }
+
+        uint32_t bit = cluster - c->window_start;
+        if (c->tracked && !(check_bitmap[bit >> 5] & (1u << (bit & 31)))) {
+            report->lost_clusters++;
+            // Every well-formed chain has exactly one end marker
+            if (end) {
+                report->lost_chains++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int fat_check_volume(fat_volume_t* vol, fat_check_report_t* report) {
+    fat_check_ctx_t ctx = {vol, report, 0, 0, true, true};
+    const fat_walk_visitor_t visitor = {
+        .enter_dir = NULL,
+        .entry = fat_check_entry,
+        .dir_done = NULL,
+        .leave_dir = NULL,
+    };
+    int first_error = 0;
+
+    memset(report, 0, sizeof(*report));
+
+    printf("\n  === FAT consistency check ===\n");
+    uint64_t start_us = time_us_64();
+    uint32_t end_cluster = vol->cluster_count + 2;
+
+    for (uint32_t start = 2; start < end_cluster; start += FAT_CHECK_WINDOW_CLUSTERS) {
+        ctx.window_start = start;
+        ctx.window_end = start + FAT_CHECK_WINDOW_CLUSTERS;
+        if (ctx.window_end > end_cluster) ctx.window_end = end_cluster;
+
+        // Past the cap only the FAT itself is still scanned for invalid values
+        if (report->passes >= FAT_CHECK_MAX_PASSES) {
+            if (report->unchecked_from == 0) report->unchecked_from = start;
+            ctx.tracked = false;
+            int result = fat_check_scan_fat(&ctx);
+            if (result < 0 && first_error == 0) first_error = result;
+            continue;
+        }
+
+        memset(check_bitmap, 0, sizeof(check_bitmap));
+
+        // The FAT32 root directory is a chain no entry points to
+        if (vol->fat_type == 32) {
+            fat_check_chain(&ctx, "/", "", vol->root_cluster, UINT32_MAX);
+        }
+
+        int result = fat_walk(vol, &visitor, &ctx);
+        if (result < 0 && first_error == 0) first_error = result;
+
+        result = fat_check_scan_fat(&ctx);
+        if (result < 0 && first_error == 0) first_error = result;
+
+        ctx.first_pass = false;
+        report->passes++;
+    }
+
+    report->check_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+    return first_error;
+}
+
+typedef struct {
+    bool open;
+    uint32_t first;             // First differing entry of the open range
+    uint32_t last;
+} fat_check_range_t;
+
+static void fat_check_close_range(fat_check_range_t* range, uint32_t copy, fat_check_copies_t* copies) {
+    if (!range->open) {
+        return;
+    }
+
+    copies->ranges++;
+    if (copies->ranges <= FAT_CHECK_MAX_MESSAGES) {
+        printf("  FAT #%u differs from FAT #1 at entries %u-%u\n", copy + 1, range->first, range->last);
+    } else if (copies->ranges == FAT_CHECK_MAX_MESSAGES + 1) {
+        printf("  ... further ranges are counted only\n");
+    }
+    range->open = false;
+}
+
+int fat_check_compare_copies(fat_volume_t* vol, fat_check_copies_t* copies) {
+    uint32_t* fat1 = check_bitmap;
+    uint32_t* fatn = check_bitmap + FAT_CHECK_BITMAP_BYTES / 8;
+    uint64_t entry_bytes = (((uint64_t)vol->cluster_count + 2) * vol->fat_type + 7) / 8;
+    uint32_t fat_sectors = vol->fat_entry_sectors;
+
+    memset(copies, 0, sizeof(*copies));
+
+    printf("\n  === FAT copy comparison ===\n");
+    if (vol->num_fats < 2) {
+        printf("  Single FAT, nothing to compare\n");
+        return 0;
+    }
+
+    uint64_t start_us = time_us_64();
+
+    for (uint32_t copy = 1; copy < vol->num_fats; copy++) {
+        uint32_t copy_lba = vol->fat_lba + copy * vol->sectors_per_fat;
+        fat_check_range_t range = {false, 0, 0};
+
+        for (uint32_t sector = 0; sector < fat_sectors; sector += FAT_CHECK_COPY_CHUNK_SECTORS) {
+            uint32_t chunk = fat_sectors - sector;
+            if (chunk > FAT_CHECK_COPY_CHUNK_SECTORS) chunk = FAT_CHECK_COPY_CHUNK_SECTORS;
+
+            if (sd_read_blocks(vol->fat_lba + sector, chunk, (uint8_t*)fat1) != 0 ||
+                sd_read_blocks(copy_lba + sector, chunk, (uint8_t*)fatn) != 0) {
+                return -1;
+            }
+
+            // Bytes past the last entry are padding and may legitimately differ
+            uint32_t chunk_bytes = chunk * 512;
+            uint32_t chunk_offset = sector * 512;
+            if (chunk_bytes > entry_bytes - chunk_offset) chunk_bytes = (uint32_t)(entry_bytes - chunk_offset);
+
+            if (memcmp(fat1, fatn, chunk_bytes) == 0) {
+                fat_check_close_range(&range, copy, copies);
+                continue;
+            }
+
+            // Locate the differing words. Bits past the last entry are masked
+            // off: the tail of the final word, and on FAT12 the spare nibble
+            uint64_t entry_bits = ((uint64_t)vol->cluster_count + 2) * vol->fat_type;
+            uint32_t words = (chunk_bytes + 3) / 4;
+            for (uint32_t i = 0; i < words; i++) {
+                uint32_t diff = fat1[i] ^ fatn[i];
+                uint64_t word_bit = ((uint64_t)chunk_offset + i * 4) * 8;
+                if (entry_bits - word_bit < 32) {
+                    diff &= (1u << (entry_bits - word_bit)) - 1;
+                }
+                if (diff == 0) {
+                    continue;
+                }
+
+                uint32_t byte = chunk_offset + i * 4;
+                uint32_t first = byte * 8 / vol->fat_type;
+                uint32_t last = (byte * 8 + 31) / vol->fat_type;
+                if (vol->fat_type == 16) {
+                    // Narrow to the 16-bit lanes that actually differ
+                    if ((diff & 0xFFFF) == 0) first++;
+                    if ((diff >> 16) == 0) last--;
+                }
+                if (last >= vol->cluster_count + 2) last = vol->cluster_count + 1;
+
+                copies->mismatched_words++;
+                if (range.open && first <= range.last + 1) {
+                    range.last = last;
+                } else {
+                    fat_check_close_range(&range, copy, copies);
+                    range.open = true;
+                    range.first = first;
+                    range.last = last;
+                }
+            }
+        }
+
+        fat_check_close_range(&range, copy, copies);
+        copies->copies_compared++;
+    }
+
+    copies->compare_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+
+    if (copies->ranges == 0) {
+        printf("  All %u FAT copies match (%u ms)\n", vol->num_fats, copies->compare_ms);
+    } else {
+        printf("  %u differing ranges, %u words (%u ms)\n",
+               copies->ranges, copies->mismatched_words, copies->compare_ms);
+    }
+    return 0;
+}
+
+bool fat_check_print(const fat_check_report_t* report) {
+    bool clean = report->cross_linked_chains == 0 && report->lost_clusters == 0 &&
+                 report->short_chains == 0 && report->long_chains == 0 &&
+                 report->broken_chains == 0 && report->looped_chains == 0 &&
+                 report->invalid_entries == 0;
+
+    printf("  Checked %u files and %u directories in %u pass%s (%u ms)\n",
+           report->files, report->dirs, report->passes,
+           report->passes == 1 ? "" : "es", report->check_ms);
+    printf("  Cross-linked chains: %u\n", report->cross_linked_chains);
+    printf("  Lost clusters: %u in %u chains\n", report->lost_clusters, report->lost_chains);
+    printf("  Chains shorter than size: %u, longer than size: %u\n",
+           report->short_chains, report->long_chains);
+    printf("  Broken chains: %u, looping chains: %u\n", report->broken_chains, report->looped_chains);
+    printf("  Invalid FAT entries: %u, bad clusters: %u\n", report->invalid_entries, report->bad_clusters);
+    if (report->unchecked_from != 0) {
+        printf("  Partial check: clusters from %u on not checked for lost or cross-linked clusters\n",
+               report->unchecked_from);
+    }
+    printf("  Verdict: %s%s\n", clean ? "CLEAN" : "ERRORS FOUND",
+           report->unchecked_from != 0 ? " (partial check)" : "");
+
+    return clean;
+}
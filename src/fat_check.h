@@ -0,0 +1,60 @@
+#ifndef FAT_CHECK_H
+#define FAT_CHECK_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+
+// Cluster bitmap held in RAM (one bit per cluster). Volumes with more
+// clusters than fit are checked in several passes over cluster windows.
+#ifndef FAT_CHECK_BITMAP_BYTES
+#define FAT_CHECK_BITMAP_BYTES 16384
+#endif
+
+// Each pass walks the whole tree again, so large volumes stop after this
+// many windows; clusters beyond them are not checked for lost or
+// cross-linked clusters and the report says the check was partial
+#ifndef FAT_CHECK_MAX_PASSES
+#define FAT_CHECK_MAX_PASSES 4
+#endif
+
+// Individual problems printed before further ones are only counted
+#define FAT_CHECK_MAX_MESSAGES 20
+
+// Read-only consistency check of one FAT volume
+typedef struct {
+    uint32_t passes;
+    uint32_t unchecked_from;    // First cluster left out by the pass cap, 0 if none
+    uint32_t files;
+    uint32_t dirs;
+    uint32_t cross_linked_chains;   // Chains running into a cluster another chain claimed
+                                    // (once per pass in which they collide)
+    uint32_t lost_clusters;     // Allocated but reachable from no entry
+    uint32_t lost_chains;       // Lost clusters ending a chain
+    uint32_t short_chains;      // Fewer clusters than the file size needs
+    uint32_t long_chains;       // More clusters than the file size needs
+    uint32_t broken_chains;     // Links to free, bad or invalid clusters
+    uint32_t looped_chains;
+    uint32_t invalid_entries;   // FAT values that are neither links nor markers
+    uint32_t bad_clusters;
+    uint32_t messages;
+    uint32_t check_ms;
+} fat_check_report_t;
+
+// Agreement between FAT #1 and its copies
+typedef struct {
+    uint32_t copies_compared;
+    uint32_t mismatched_words;
+    uint32_t ranges;            // Runs of differing FAT entries
+    uint32_t compare_ms;
+} fat_check_copies_t;
+
+int fat_check_volume(fat_volume_t* vol, fat_check_report_t* report);
+
+// Stream FAT #1 and every further copy side by side and print the ranges
+// of entries that differ. Shares the checker's bitmap as read buffers.
+int fat_check_compare_copies(fat_volume_t* vol, fat_check_copies_t* copies);
+
+// Print the totals; returns true when the volume is consistent
+bool fat_check_print(const fat_check_report_t* report);
+
+#endif // FAT_CHECK_H
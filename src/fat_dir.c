@@ -0,0 +1,337 @@
+#include "fat_dir.h"
+#include "sd_analyzer.h"
+#include "sd_card.h"
+#include <stdio.h>
+#include <string.h>
+
+void fat_dir_open(fat_dir_iter_t* it, fat_volume_t* vol, uint32_t first_cluster) {
+    memset(it, 0, sizeof(*it));
+    it->vol = vol;
+
+    // Cluster 0 means the root directory (also how ".." refers to it)
+    if (first_cluster == 0 && vol->fat_type != 32) {
+        it->fixed_root = true;
+    } else if (first_cluster == 0) {
+        first_cluster = vol->root_cluster;
+    }
+
+    it->first_cluster = first_cluster;
+    it->cluster = first_cluster;
+
+    if (!it->fixed_root && !fat_volume_is_data_cluster(vol, first_cluster)) {
+        it->done = true;
+        it->error = -4;
+    }
+}
+
+int fat_dir_seek(fat_dir_iter_t* it, uint32_t index) {
+    fat_volume_t* vol = it->vol;
+    uint32_t entries_per_unit = it->fixed_root ? 16 : vol->sectors_per_cluster * 16;
+    uint32_t unit = index / entries_per_unit;
+
+    it->index = index;
+    it->sector_in_unit = (index % entries_per_unit) / 16;
+    it->sector_loaded = false;
+    it->done = false;
+    it->error = 0;
+    fat_lfn_reset(&it->lfn);
+
+    if (it->fixed_root) {
+        it->sector_in_unit = unit;
+        if (unit >= vol->root_dir_sectors) {
+            it->done = true;
+        }
+        return 0;
+    }
+
+    // Follow the chain through the FAT window to the cluster holding index
+    it->cluster = it->first_cluster;
+    if (it->first_cluster_only && unit > 0) {
+        it->done = true;
+        return 0;
+    }
+    for (uint32_t hop = 0; hop < unit; hop++) {
+        int result = fat_volume_next_cluster(vol, it->cluster, &it->cluster);
+        if (result <= 0) {
+            it->done = true;
+            it->error = result;
+            return result < 0 ? result : -5;
+        }
+    }
+
+    return 0;
+}
+
+// Move to the entry after the one just consumed
+static void fat_dir_advance(fat_dir_iter_t* it) {
+    it->index++;
+    if (it->index % 16 != 0) {
+        return;
+    }
+
+    it->sector_loaded = false;
+    it->sector_in_unit++;
+
+    if (it->fixed_root) {
+        if (it->sector_in_unit >= it->vol->root_dir_sectors) {
+            it->done = true;
+        }
+        return;
+    }
+
+    if (it->sector_in_unit >= it->vol->sectors_per_cluster) {
+        it->sector_in_unit = 0;
+        if (it->first_cluster_only) {
+            it->done = true;
+            return;
+        }
+        int result = fat_volume_next_cluster(it->vol, it->cluster, &it->cluster);
+        if (result <= 0) {
+            it->done = true;
+            it->error = result;
+        }
+    }
+}
+
+// Top bit of every byte lane of w that is exactly zero
+static inline uint32_t zero_lanes(uint32_t w) {
+    return ~(((w & 0x7F7F7F7F) + 0x7F7F7F7F) | w) & 0x80808080;
+}
+
+// Gather the top bit of each byte lane into a 4-bit mask (lane 0 = bit 0).
+// The multiply places the four flags at bits 21..24 without carries.
+static inline uint32_t lane_mask(uint32_t flags) {
+    return (((flags >> 7) * 0x00204081) >> 21) & 0xF;
+}
+
+void fat_dir_classify_sector(const uint8_t* sector, fat_dir_class_t* classes) {
+    uint32_t end = 0, deleted = 0, lfn = 0, volume = 0;
+
+    // Four entries per pass: their first bytes and attributes share a word
+    for (int group = 0; group < 4; group++) {
+        const uint8_t* e = &sector[group * 128];
+        uint32_t first = e[0] | (e[32] << 8) | (e[64] << 16) | ((uint32_t)e[96] << 24);
+        uint32_t attr = e[11] | (e[43] << 8) | (e[75] << 16) | ((uint32_t)e[107] << 24);
+        int shift = group * 4;
+
+        end |= lane_mask(zero_lanes(first)) << shift;
+        deleted |= lane_mask(zero_lanes(first ^ 0xE5E5E5E5)) << shift;
+        lfn |= lane_mask(zero_lanes((attr & 0x3F3F3F3F) ^ 0x0F0F0F0F)) << shift;
+        volume |= lane_mask((attr << 4) & 0x80808080) << shift;
+    }
+
+    // Slots from the first end marker on are free whatever they contain
+    uint32_t free = end ? (0xFFFF & ~((end & -end) - 1)) : 0;
+    uint32_t live = 0xFFFF & ~free & ~deleted;
+
+    classes->free = (uint16_t)free;
+    classes->deleted = (uint16_t)(deleted & ~free);
+    classes->lfn = (uint16_t)(lfn & live);
+    classes->volume = (uint16_t)(volume & ~lfn & live);
+    classes->regular = (uint16_t)(live & ~lfn & ~volume);
+}
+
+static void fat_dir_format_short_name(const uint8_t* entry, char* out) {
+    int len = 0;
+
+    for (int j = 0; j < 8 && entry[j] != ' '; j++) {
+        out[len++] = (j == 0 && entry[0] == 0x05) ? (char)0xE5 : (char)entry[j];
+    }
+
+    if (entry[8] != ' ') {
+        out[len++] = '.';
+        for (int j = 8; j < 11 && entry[j] != ' '; j++) {
+            out[len++] = (char)entry[j];
+        }
+    }
+
+    out[len] = 0;
+}
+
+static void fat_dir_fill_entry(const uint8_t* entry, uint32_t index, fat_dirent_t* ent) {
+    ent->attributes = entry[11];
+    ent->size = entry[28] | (entry[29] << 8) | (entry[30] << 16) | ((uint32_t)entry[31] << 24);
+    ent->first_cluster = (entry[26] | (entry[27] << 8)) |
+                         ((uint32_t)(entry[20] | (entry[21] << 8)) << 16);
+    ent->mod_time = entry[22] | (entry[23] << 8);
+    ent->mod_date = entry[24] | (entry[25] << 8);
+    ent->index = index;
+}
+
+// Reconstruct a deleted entry. Deleted LFN fragments are collected until
+// their 8.3 entry; returns true once a whole entry has been produced.
+static bool fat_dir_read_deleted(fat_dir_iter_t* it, const uint8_t* entry, uint32_t index,
+                                 fat_dirent_t* ent) {
+    if ((entry[11] & 0x3F) == FAT_ATTR_LFN) {
+        fat_lfn_add_deleted(&it->lfn, entry, index);
+        return false;
+    }
+
+    if (entry[11] & FAT_ATTR_VOLUME_ID) {
+        fat_lfn_reset(&it->lfn);
+        return false;
+    }
+
+    // The first character was overwritten by the 0xE5 marker
+    uint8_t short_entry[11];
+    uint8_t first_char = '?';
+    uint32_t lfn_index = it->lfn.first_index;
+    int len = fat_lfn_finish_deleted(&it->lfn, entry, &first_char, ent->name, sizeof(ent->name));
+
+    memcpy(short_entry, entry, sizeof(short_entry));
+    short_entry[0] = first_char;
+    fat_dir_format_short_name(short_entry, ent->short_name);
+
+    if (len > 0) {
+        ent->set_index = lfn_index;
+    } else {
+        strcpy(ent->name, ent->short_name);
+        ent->set_index = index;
+    }
+
+    fat_dir_fill_entry(entry, index, ent);
+    ent->deleted = true;
+    return true;
+}
+
+int fat_dir_next(fat_dir_iter_t* it, fat_dirent_t* ent) {
+    while (!it->done) {
+        if (!it->sector_loaded) {
+            uint32_t lba = it->fixed_root ?
+                it->vol->root_dir_lba + it->sector_in_unit :
+                fat_volume_cluster_to_lba(it->vol, it->cluster) + it->sector_in_unit;
+
+            if (sd_read_block(lba, it->sector) != 0) {
+                it->done = true;
+                it->error = -1;
+                break;
+            }
+            fat_dir_classify_sector(it->sector, &it->classes);
+            it->sector_loaded = true;
+        }
+
+        const fat_dir_class_t* classes = &it->classes;
+        uint32_t slot = it->index % 16;
+        uint32_t bit = 1u << slot;
+
+        if (classes->free & bit) {
+            it->done = true; // End of directory marker
+            break;
+        }
+
+        // Jump straight to the next live entry, or past the end of the sector
+        uint32_t ahead = 0xFFFF & ~(bit - 1);
+        uint32_t wanted = classes->lfn | classes->volume | classes->regular;
+        if (it->include_deleted) wanted |= classes->deleted;
+        uint32_t live = wanted & ahead;
+        uint32_t stop = live | (classes->free & ahead);
+        uint32_t target = stop ? (uint32_t)__builtin_ctz(stop) : 16;
+
+        if (target != slot) {
+            // LFN fragments before a deleted entry are orphans
+            if (classes->deleted & ahead & ((1u << target) - 1)) {
+                fat_lfn_reset(&it->lfn);
+            }
+            it->index += target - slot - 1;
+            fat_dir_advance(it);
+            continue;
+        }
+
+        const uint8_t* entry = &it->sector[slot * 32];
+        uint32_t index = it->index;
+
+        fat_dir_advance(it);
+
+        if (classes->deleted & bit) {
+            if (fat_dir_read_deleted(it, entry, index, ent)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (classes->lfn & bit) {
+            fat_lfn_add(&it->lfn, entry, index);
+            continue;
+        }
+
+        // Skip volume labels and the "." / ".." links
+        if ((classes->volume & bit) || entry[0] == '.') {
+            fat_lfn_reset(&it->lfn);
+            continue;
+        }
+
+        if (it->filter && !it->filter(entry, it->filter_ctx)) {
+            fat_lfn_reset(&it->lfn);
+            continue;
+        }
+
+        fat_dir_format_short_name(entry, ent->short_name);
+
+        uint32_t lfn_index = it->lfn.first_index;
+        if (fat_lfn_finish(&it->lfn, entry, ent->name, sizeof(ent->name)) > 0) {
+            ent->set_index = lfn_index;
+        } else {
+            strcpy(ent->name, ent->short_name[0] ? ent->short_name : "<no name>");
+            ent->set_index = index;
+        }
+
+        fat_dir_fill_entry(entry, index, ent);
+        ent->deleted = false;
+        return 1;
+    }
+
+    return it->error;
+}
+
+// Iterator used by lookups, kept off the stack
+static fat_dir_iter_t find_iter;
+
+static bool fat_dir_name_equals(const char* a, const char* b, size_t b_len) {
+    size_t i = 0;
+    for (; i < b_len && a[i] != 0; i++) {
+        char ca = (a[i] >= 'a' && a[i] <= 'z') ? a[i] - 32 : a[i];
+        char cb = (b[i] >= 'a' && b[i] <= 'z') ? b[i] - 32 : b[i];
+        if (ca != cb) return false;
+    }
+    return i == b_len && a[i] == 0;
+}
+
+int fat_dir_find(fat_volume_t* vol, uint32_t dir_cluster, const char* name, size_t name_len,
+                 fat_dirent_t* ent) {
+    int result;
+
+    fat_dir_open(&find_iter, vol, dir_cluster);
+    while ((result = fat_dir_next(&find_iter, ent)) > 0) {
+        if (fat_dir_name_equals(ent->name, name, name_len) ||
+            fat_dir_name_equals(ent->short_name, name, name_len)) {
+            return 1;
+        }
+    }
+
+    return result;
+}
+
+void fat_dir_print_entry(const fat_dirent_t* ent) {
+    uint8_t attributes = ent->attributes;
+    bool is_dir = (attributes & FAT_ATTR_DIRECTORY) != 0;
+    char w = (attributes & FAT_ATTR_READ_ONLY) ? '-' : 'w';
+    char x = is_dir ? 'x' : '-';
+
+    printf("  %cr%c%cr%c%cr%c%c %2d", is_dir ? 'd' : '-', w, x, w, x, w, x, 1);
+
+    if (is_dir) {
+        printf(" %10s", "<DIR>");
+    } else {
+        printf(" %10u", ent->size);
+    }
+
+    char datetime_str[32];
+    sd_analyzer_format_fat_datetime(ent->mod_date, ent->mod_time, datetime_str, sizeof(datetime_str));
+    printf(" %s %s", datetime_str, ent->name);
+
+    if (strcmp(ent->name, ent->short_name) != 0) {
+        printf(" [%s]", ent->short_name);
+    }
+
+    printf("\n");
+}
@@ -0,0 +1,81 @@
+#ifndef FAT_DIR_H
+#define FAT_DIR_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+#include "fat_lfn.h"
+
+#define FAT_DIR_NAME_MAX 256
+
+// FAT directory entry attributes
+#define FAT_ATTR_READ_ONLY 0x01
+#define FAT_ATTR_HIDDEN    0x02
+#define FAT_ATTR_SYSTEM    0x04
+#define FAT_ATTR_VOLUME_ID 0x08
+#define FAT_ATTR_DIRECTORY 0x10
+#define FAT_ATTR_ARCHIVE   0x20
+#define FAT_ATTR_LFN       0x0F
+
+// One decoded directory entry (LFN set plus its 8.3 entry)
+typedef struct {
+    char name[FAT_DIR_NAME_MAX];    // UTF-8 long name if present, else 8.3 name
+    char short_name[13];
+    uint8_t attributes;
+    uint32_t size;
+    uint32_t first_cluster;
+    uint16_t mod_date;
+    uint16_t mod_time;
+    uint32_t index;                 // Index of the 8.3 entry in the directory
+    uint32_t set_index;             // Index of the first entry of the LFN set
+    bool deleted;                   // Only returned when include_deleted is set
+} fat_dirent_t;
+
+// Per-sector entry classes, one bit per entry slot (bit 0 = first entry).
+// Free slots are the end marker and everything after it.
+typedef struct {
+    uint16_t free;
+    uint16_t deleted;
+    uint16_t lfn;
+    uint16_t volume;
+    uint16_t regular;               // Files, directories and the dot links
+} fat_dir_class_t;
+
+// Streaming iterator over one directory. Only one sector is held in RAM;
+// the position can be saved as an entry index and restored with seek.
+typedef struct {
+    fat_volume_t* vol;
+    uint32_t first_cluster;         // 0 = root directory
+    uint32_t cluster;               // Current cluster (chained directories)
+    uint32_t sector_in_unit;        // Sector within cluster or root region
+    uint32_t index;                 // Index of the next entry to read
+    bool sector_loaded;
+    bool done;
+    int error;
+    bool fixed_root;                // FAT12/16 root region, not a chain
+    bool include_deleted;           // Also return 0xE5 entries (set after open)
+    bool first_cluster_only;        // Deleted directory whose chain was freed:
+                                    // stop after its first cluster (set after open)
+    // Optional test on the raw 8.3 entry, run before its name is assembled;
+    // entries it rejects are skipped (set after open)
+    bool (*filter)(const uint8_t* entry, void* ctx);
+    void* filter_ctx;
+    uint8_t sector[512];
+    fat_dir_class_t classes;        // Classification of sector
+    fat_lfn_t lfn;
+} fat_dir_iter_t;
+
+// Classify all 16 entries of a directory sector at once
+void fat_dir_classify_sector(const uint8_t* sector, fat_dir_class_t* classes);
+
+void fat_dir_open(fat_dir_iter_t* it, fat_volume_t* vol, uint32_t first_cluster);
+int fat_dir_seek(fat_dir_iter_t* it, uint32_t index);
+int fat_dir_next(fat_dir_iter_t* it, fat_dirent_t* ent);
+
+// Find one name (case-insensitive, long or 8.3) in a directory
+int fat_dir_find(fat_volume_t* vol, uint32_t dir_cluster, const char* name, size_t name_len,
+                 fat_dirent_t* ent);
+
+// Print one entry in the same 'ls -l' style as sd_analyzer_list_fat_directory()
+void fat_dir_print_entry(const fat_dirent_t* ent);
+
+#endif // FAT_DIR_H
@@ -0,0 +1,160 @@
+#include "fat_du.h"
+#include "partition_display.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    fat_volume_t* vol;
+    fat_du_report_t* report;
+    uint32_t depth;                             // Depth of the directory entered last
+    fat_du_totals_t stack[FAT_WALK_MAX_DEPTH];  // Running totals along the current path
+} fat_du_ctx_t;
+
+// Allocated size of a chain, following it to the end
+static uint64_t fat_du_chain_bytes(fat_du_ctx_t* du, uint32_t first_cluster) {
+    fat_volume_t* vol = du->vol;
+    uint32_t cluster = first_cluster;
+    uint32_t clusters = 0;
+    fat_extent_t extent;
+    int result;
+
+    while ((result = fat_volume_next_extent(vol, &cluster, &extent)) > 0) {
+        clusters += extent.cluster_count;
+        if (clusters > vol->cluster_count) {
+            result = -5; // Chain loops back on itself
+            break;
+        }
+    }
+
+    if (result < 0) {
+        du->report->chain_errors++;
+    }
+    return (uint64_t)clusters * fat_volume_cluster_bytes(vol);
+}
+
+static void fat_du_enter(const char* path, uint32_t first_cluster, uint32_t depth, void* ctx) {
+    (void)path;
+    fat_du_ctx_t* du = ctx;
+    fat_du_totals_t* totals = &du->stack[depth];
+
+    memset(totals, 0, sizeof(*totals));
+    du->depth = depth;
+
+    // The FAT12/16 root sits in a fixed region and holds no clusters
+    if (first_cluster == 0 && du->vol->fat_type == 32) {
+        first_cluster = du->vol->root_cluster;
+    }
+    if (first_cluster != 0) {
+        totals->allocated_bytes = fat_du_chain_bytes(du, first_cluster);
+    }
+}
+
+static void fat_du_entry(const char* path, const fat_dirent_t* ent, void* ctx) {
+    (void)path;
+    fat_du_ctx_t* du = ctx;
+    fat_du_totals_t* totals = &du->stack[du->depth];
+
+    // Subdirectories are counted, and their chains followed, on entry
+    if (ent->attributes & FAT_ATTR_DIRECTORY) {
+        totals->dirs++;
+        return;
+    }
+
+    totals->files++;
+    totals->logical_bytes += ent->size;
+    if (ent->first_cluster != 0) {
+        totals->allocated_bytes += fat_du_chain_bytes(du, ent->first_cluster);
+    }
+}
+
+static void fat_du_record_top(fat_du_report_t* report, const char* path, const fat_du_totals_t* totals) {
+    uint32_t pos = report->top_count;
+
+    // Keep the list sorted by allocated size, largest first
+    while (pos > 0 && report->top[pos - 1].totals.allocated_bytes < totals->allocated_bytes) {
+        if (pos < FAT_DU_TOP_DIRS) {
+            report->top[pos] = report->top[pos - 1];
+        }
+        pos--;
+    }
+
+    if (pos >= FAT_DU_TOP_DIRS) {
+        return;
+    }
+
+    report->top[pos].totals = *totals;
+    snprintf(report->top[pos].path, sizeof(report->top[pos].path), "%s", path);
+
+    if (report->top_count < FAT_DU_TOP_DIRS) {
+        report->top_count++;
+    }
+}
+
+// Post-order: the subtree is complete, so fold it into the parent
+static void fat_du_leave(const char* path, void* ctx) {
+    fat_du_ctx_t* du = ctx;
+    uint32_t depth = du->depth;
+    fat_du_totals_t* totals = &du->stack[depth];
+
+    fat_du_record_top(du->report, path, totals);
+
+    if (depth == 0) {
+        du->report->volume = *totals;
+        return;
+    }
+
+    fat_du_totals_t* parent = &du->stack[depth - 1];
+    parent->logical_bytes += totals->logical_bytes;
+    parent->allocated_bytes += totals->allocated_bytes;
+    parent->files += totals->files;
+    parent->dirs += totals->dirs;
+    du->depth = depth - 1;
+}
+
+int fat_du_analyze(fat_volume_t* vol, fat_du_report_t* report) {
+    static fat_du_ctx_t ctx;
+    const fat_walk_visitor_t visitor = {
+        .enter_dir = fat_du_enter,
+        .entry = fat_du_entry,
+        .dir_done = NULL,
+        .leave_dir = fat_du_leave,
+    };
+
+    memset(report, 0, sizeof(*report));
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.vol = vol;
+    ctx.report = report;
+
+    return fat_walk(vol, &visitor, &ctx);
+}
+
+static void fat_du_print_line(const fat_du_totals_t* totals, const char* path) {
+    char logical_str[32];
+    char allocated_str[32];
+    uint64_t slack = totals->allocated_bytes > totals->logical_bytes ?
+                     totals->allocated_bytes - totals->logical_bytes : 0;
+
+    partition_display_format_size(totals->logical_bytes, logical_str, sizeof(logical_str));
+    partition_display_format_size(totals->allocated_bytes, allocated_str, sizeof(allocated_str));
+
+    printf("  %12s %12s %5.1f%% %7u  %s\n", logical_str, allocated_str,
+           totals->allocated_bytes ? slack * 100.0 / totals->allocated_bytes : 0.0,
+           totals->files, path);
+}
+
+void fat_du_print(const fat_du_report_t* report) {
+    printf("\n  === Disk usage ===\n");
+    printf("  %12s %12s %6s %7s  %s\n", "logical", "on disk", "slack", "files", "directory");
+
+    for (uint32_t i = 0; i < report->top_count; i++) {
+        fat_du_print_line(&report->top[i].totals, report->top[i].path);
+    }
+
+    printf("  Volume: %u files in %u directories\n",
+           report->volume.files, report->volume.dirs);
+    fat_du_print_line(&report->volume, "(total)");
+
+    if (report->chain_errors > 0) {
+        printf("  Broken cluster chains: %u\n", report->chain_errors);
+    }
+}
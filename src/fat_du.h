@@ -0,0 +1,34 @@
+#ifndef FAT_DU_H
+#define FAT_DU_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+#include "fat_walk.h"
+
+#define FAT_DU_TOP_DIRS  10
+#define FAT_DU_PATH_MAX  128
+
+// Sizes of a directory's whole subtree
+typedef struct {
+    uint64_t logical_bytes;     // Sum of file sizes
+    uint64_t allocated_bytes;   // Clusters held by files and directories
+    uint32_t files;
+    uint32_t dirs;
+} fat_du_totals_t;
+
+typedef struct {
+    fat_du_totals_t totals;
+    char path[FAT_DU_PATH_MAX];
+} fat_du_dir_t;
+
+typedef struct {
+    fat_du_totals_t volume;
+    uint32_t chain_errors;
+    uint32_t top_count;
+    fat_du_dir_t top[FAT_DU_TOP_DIRS];  // Largest by allocated size
+} fat_du_report_t;
+
+int fat_du_analyze(fat_volume_t* vol, fat_du_report_t* report);
+void fat_du_print(const fat_du_report_t* report);
+
+#endif // FAT_DU_H
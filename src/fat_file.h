@@ -0,0 +1,31 @@
+#ifndef FAT_FILE_H
+#define FAT_FILE_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+#include "fat_dir.h"
+
+// Extents of a file kept resolved at once
+#define FAT_FILE_EXTENT_CACHE 8
+
+// Open file on a FAT volume. The cluster chain is resolved lazily into a
+// window of extents; sequential reads slide the window along the chain.
+typedef struct {
+    fat_volume_t* vol;
+    uint32_t first_cluster;
+    uint32_t size;
+    uint8_t attributes;
+    uint32_t extent_count;
+    uint32_t extent_start[FAT_FILE_EXTENT_CACHE];   // File cluster index of each extent
+    fat_extent_t extents[FAT_FILE_EXTENT_CACHE];
+    uint32_t chain_cluster;     // Volume cluster after the cached extents (0 = end)
+    uint32_t chain_index;       // File cluster index of chain_cluster
+} fat_file_t;
+
+int fat_file_open_entry(fat_file_t* file, fat_volume_t* vol, const fat_dirent_t* ent);
+int fat_file_open_path(fat_file_t* file, fat_volume_t* vol, const char* path);
+
+// Read up to length bytes at offset; returns bytes read or a negative error
+int32_t fat_file_read(fat_file_t* file, uint32_t offset, uint8_t* buffer, uint32_t length);
+
+#endif // FAT_FILE_H
@@ -0,0 +1,131 @@
+#include "fat_find.h"
+#include "fat_walk.h"
+#include "sd_analyzer.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const fat_find_query_t* query;
+    fat_find_stats_t* stats;
+} fat_find_ctx_t;
+
+void fat_find_query_init(fat_find_query_t* query) {
+    query->name_glob = NULL;
+    query->min_size = 0;
+    query->max_size = 0xFFFFFFFF;
+    query->min_time = 0;
+    query->max_time = FAT_FIND_TIME_ANY;
+    query->attr_set = 0;
+    query->attr_clear = 0;
+}
+
+static char fat_find_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? c - 32 : c;
+}
+
+// Iterative wildcard match: on a mismatch, retry from the last '*'
+bool fat_find_glob_match(const char* glob, const char* name) {
+    const char* star = NULL;
+    const char* resume = NULL;
+
+    while (*name) {
+        if (*glob == '*') {
+            star = glob++;
+            resume = name;
+        } else if (*glob == '?' || (*glob && fat_find_upper(*glob) == fat_find_upper(*name))) {
+            glob++;
+            name++;
+        } else if (star) {
+            glob = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+
+    while (*glob == '*') glob++;
+    return *glob == 0;
+}
+
+// Predicates that only need fields of the 32-byte entry
+static bool fat_find_fields_match(const fat_find_query_t* query, uint8_t attributes,
+                                  uint32_t size, uint16_t mod_date, uint16_t mod_time) {
+    uint32_t stamp = ((uint32_t)mod_date << 16) | mod_time;
+
+    if (attributes & FAT_ATTR_DIRECTORY) {
+        size = 0;
+    }
+
+    return (attributes & query->attr_set) == query->attr_set &&
+           (attributes & query->attr_clear) == 0 &&
+           size >= query->min_size && size <= query->max_size &&
+           stamp >= query->min_time && stamp <= query->max_time;
+}
+
+static bool fat_find_raw_match(const fat_find_query_t* query, const uint8_t* entry) {
+    return fat_find_fields_match(query, entry[11],
+                                 entry[28] | (entry[29] << 8) | (entry[30] << 16) | ((uint32_t)entry[31] << 24),
+                                 entry[24] | (entry[25] << 8), entry[22] | (entry[23] << 8));
+}
+
+static bool fat_find_filter(const uint8_t* entry, void* ctx) {
+    fat_find_ctx_t* find = ctx;
+
+    find->stats->examined++;
+    if (fat_find_raw_match(find->query, entry)) {
+        return true;
+    }
+
+    find->stats->rejected_raw++;
+    return false;
+}
+
+static void fat_find_entry(const char* path, const fat_dirent_t* ent, void* ctx) {
+    fat_find_ctx_t* find = ctx;
+    const fat_find_query_t* query = find->query;
+
+    // Directories reach here unfiltered so the walk can descend into them
+    if ((ent->attributes & FAT_ATTR_DIRECTORY) &&
+        !fat_find_fields_match(query, ent->attributes, ent->size, ent->mod_date, ent->mod_time)) {
+        return;
+    }
+
+    if (query->name_glob && !fat_find_glob_match(query->name_glob, ent->name) &&
+        !fat_find_glob_match(query->name_glob, ent->short_name)) {
+        return;
+    }
+
+    char datetime_str[32];
+    sd_analyzer_format_fat_datetime(ent->mod_date, ent->mod_time, datetime_str, sizeof(datetime_str));
+
+    if (ent->attributes & FAT_ATTR_DIRECTORY) {
+        printf("  %10s", "<DIR>");
+    } else {
+        printf("  %10u", ent->size);
+    }
+    printf(" %s %s%s%s\n", datetime_str, path, strcmp(path, "/") == 0 ? "" : "/", ent->name);
+
+    find->stats->matches++;
+}
+
+int fat_find(fat_volume_t* vol, const fat_find_query_t* query, fat_find_stats_t* stats) {
+    fat_find_ctx_t ctx = {query, stats};
+    const fat_walk_visitor_t visitor = {
+        .enter_dir = NULL,
+        .entry = fat_find_entry,
+        .dir_done = NULL,
+        .leave_dir = NULL,
+        .filter = fat_find_filter,
+    };
+
+    memset(stats, 0, sizeof(*stats));
+    printf("\n  === Find %s ===\n", query->name_glob ? query->name_glob : "*");
+
+    uint64_t start_us = time_us_64();
+    int result = fat_walk(vol, &visitor, &ctx);
+    stats->find_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+
+    printf("  %u matches; %u of %u entries rejected before name decoding (%u ms)\n",
+           stats->matches, stats->rejected_raw, stats->examined, stats->find_ms);
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef FAT_FIND_H
+#define FAT_FIND_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+
+// Packed FAT date and time for timestamp ranges: (date << 16) | time
+#define FAT_FIND_DATE(year, month, day) \
+    ((uint32_t)((((year) - 1980) << 9) | ((month) << 5) | (day)) << 16)
+#define FAT_FIND_TIME_ANY 0xFFFFFFFF
+
+// find-style query; every predicate must hold for an entry to match
+typedef struct {
+    const char* name_glob;      // '*' and '?' wildcards, case-insensitive; NULL = any
+    uint32_t min_size;
+    uint32_t max_size;
+    uint32_t min_time;          // Packed modification time range, inclusive
+    uint32_t max_time;
+    uint8_t attr_set;           // Attributes that must be set
+    uint8_t attr_clear;         // Attributes that must be clear
+} fat_find_query_t;
+
+typedef struct {
+    uint32_t examined;          // Entries seen by the raw filter
+    uint32_t rejected_raw;      // Dropped before their names were assembled
+    uint32_t matches;
+    uint32_t find_ms;
+} fat_find_stats_t;
+
+// A query that matches every entry
+void fat_find_query_init(fat_find_query_t* query);
+
+bool fat_find_glob_match(const char* glob, const char* name);
+
+// Walk the volume and print matches as they are found
+int fat_find(fat_volume_t* vol, const fat_find_query_t* query, fat_find_stats_t* stats);
+
+#endif // FAT_FIND_H
@@ -0,0 +1,427 @@
+#include "fat_format.h"
+#include "sd_block.h"
+#include "partition_display.h"
+#include <stdio.h>
+#include <string.h>
+
+// Cluster size and boundary unit by capacity, from the SD Association's
+// File System Specification. Cards above 32 GB are SDXC and take exFAT.
+typedef struct {
+    uint32_t max_sectors;
+    uint8_t fat_type;
+    uint8_t sectors_per_cluster;
+    uint32_t boundary_sectors;
+} fat_format_rule_t;
+
+static const fat_format_rule_t format_rules[] = {
+    {16384,    12, 16, 16},     // <= 8 MB
+    {131072,   12, 32, 32},     // <= 64 MB
+    {524288,   16, 32, 64},     // <= 256 MB
+    {2097152,  16, 32, 128},    // <= 1 GB
+    {4194304,  16, 64, 128},    // <= 2 GB
+    {67108864, 32, 64, 8192},   // <= 32 GB
+};
+
+// AU_SIZE codes 0xA-0xF of the SD Status are not powers of two
+static const uint32_t au_large_sectors[] = {16384, 24576, 32768, 49152, 65536, 131072};
+
+// Root directory entries on FAT12/16, one 16 KB run of sectors
+#define FORMAT_ROOT_ENTRIES 512
+
+// Partitions ending beyond this cannot be addressed by CHS (1024/255/63)
+#define FORMAT_CHS_LIMIT 16450560
+
+// Metadata is built chunk by chunk and sent with multi-block writes
+static uint8_t format_buffer[FAT_FORMAT_CHUNK_SECTORS * 512];
+
+static void write_le16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void write_le32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+int fat_format_read_geometry(fat_format_geometry_t* geo) {
+    static uint8_t status[SD_STATUS_SIZE];
+
+    memset(geo, 0, sizeof(*geo));
+
+    // pico-sd-lib's block count is a placeholder, so take it from the CSD
+    if (sd_read_capacity(&geo->card_sectors) != 0 || geo->card_sectors == 0) {
+        return -1;
+    }
+
+    // Without the SD Status the layout still follows the capacity table
+    if (sd_read_sd_status(status) != 0) {
+        return 0;
+    }
+
+    uint8_t au_code = status[10] >> 4;
+    if (au_code >= 0xA) {
+        geo->au_sectors = au_large_sectors[au_code - 0xA];
+    } else if (au_code > 0) {
+        geo->au_sectors = 32u << (au_code - 1);
+    }
+
+    geo->erase_size = (status[11] << 8) | status[12];
+    geo->erase_timeout = status[13] >> 2;
+    geo->erase_offset = status[13] & 0x03;
+    return 0;
+}
+
+// Place the FATs and root directory for the chosen type and cluster size so
+// that the first data sector falls on a boundary
+static void fat_format_layout(fat_format_plan_t* plan, uint32_t card_sectors) {
+    uint32_t boundary = plan->boundary_sectors;
+    uint32_t spc = plan->sectors_per_cluster;
+    uint32_t sf = 1;
+
+    if (plan->fat_type == 32) {
+        // Partition starts on a boundary; reserved sectors absorb the FAT size
+        uint32_t ts = card_sectors - boundary;
+        uint32_t rsc, clusters;
+
+        for (;;) {
+            rsc = boundary - (2 * sf) % boundary;
+            if (rsc < 32) {
+                rsc += boundary; // Room for FSInfo and the backup boot sector
+            }
+            clusters = (ts - rsc - 2 * sf) / spc;
+
+            uint32_t need = ((clusters + 2) * 4 + 511) / 512;
+            if (need <= sf) break;
+            sf = need;
+        }
+
+        plan->partition_lba = boundary;
+        plan->partition_sectors = ts;
+        plan->reserved_sectors = rsc;
+        plan->root_entries = 0;
+        plan->cluster_count = clusters;
+    } else {
+        // Reserved sectors and root are fixed; the partition start moves instead
+        uint32_t root_sectors = FORMAT_ROOT_ENTRIES * 32 / 512;
+        uint32_t nom, ts, clusters;
+
+        for (;;) {
+            uint32_t meta = 1 + 2 * sf + root_sectors;
+            nom = boundary - meta % boundary;
+            if (nom < boundary) {
+                nom += boundary; // Keep the MBR in a boundary unit of its own
+            }
+            ts = card_sectors - nom;
+            clusters = (ts - meta) / spc;
+
+            uint32_t need = (plan->fat_type == 12)
+                ? ((clusters + 2) * 3 / 2 + 1 + 511) / 512
+                : ((clusters + 2) * 2 + 511) / 512;
+            if (need <= sf) break;
+            sf = need;
+        }
+
+        plan->partition_lba = nom;
+        plan->partition_sectors = ts;
+        plan->reserved_sectors = 1;
+        plan->root_entries = FORMAT_ROOT_ENTRIES;
+        plan->cluster_count = clusters;
+    }
+
+    plan->sectors_per_fat = sf;
+    plan->fat_lba = plan->partition_lba + plan->reserved_sectors;
+    plan->first_data_lba = plan->fat_lba + 2 * sf + plan->root_entries * 32 / 512;
+    plan->metadata_sectors = plan->first_data_lba + (plan->fat_type == 32 ? spc : 0);
+}
+
+int fat_format_plan(const fat_format_geometry_t* geo, fat_format_plan_t* plan) {
+    const fat_format_rule_t* rule = NULL;
+
+    memset(plan, 0, sizeof(*plan));
+
+    for (uint32_t i = 0; i < sizeof(format_rules) / sizeof(format_rules[0]); i++) {
+        if (geo->card_sectors <= format_rules[i].max_sectors) {
+            rule = &format_rules[i];
+            break;
+        }
+    }
+
+    if (!rule) {
+        return -3; // SDXC capacity: exFAT, not FAT
+    }
+
+    // Align to the AU when it is a multiple of the boundary unit, as long as
+    // the slack before the data region stays small against the capacity
+    uint32_t boundary = rule->boundary_sectors;
+    while (boundary < geo->au_sectors && geo->au_sectors % (boundary * 2) == 0 &&
+           boundary * 2 <= FAT_FORMAT_MAX_BOUNDARY &&
+           boundary * 2 * 64 <= geo->card_sectors) {
+        boundary *= 2;
+    }
+
+    plan->fat_type = rule->fat_type;
+    plan->sectors_per_cluster = rule->sectors_per_cluster;
+    plan->boundary_sectors = boundary;
+
+    if (geo->card_sectors < 4 * boundary) {
+        return -2; // Too small to hold the layout
+    }
+
+    // Capacities near a table edge can land outside the cluster range of the
+    // type; adjust the cluster size until the count and type agree
+    for (int attempt = 0; attempt < 8; attempt++) {
+        fat_format_layout(plan, geo->card_sectors);
+
+        uint32_t min_clusters = (plan->fat_type == 32) ? 65525 : (plan->fat_type == 16) ? 4085 : 1;
+        uint32_t max_clusters = (plan->fat_type == 12) ? 4084 : (plan->fat_type == 16) ? 65524 : 0x0FFFFFF5;
+
+        if (plan->cluster_count < min_clusters && plan->sectors_per_cluster > 1) {
+            plan->sectors_per_cluster /= 2;
+        } else if (plan->cluster_count > max_clusters && plan->sectors_per_cluster < 128 &&
+                   plan->sectors_per_cluster * 2u <= boundary) {
+            plan->sectors_per_cluster *= 2;
+        } else if (plan->cluster_count >= min_clusters && plan->cluster_count <= max_clusters) {
+            break;
+        } else {
+            return -2;
+        }
+    }
+
+    if (plan->first_data_lba % boundary != 0) {
+        return -2;
+    }
+
+    if (plan->fat_type == 12) {
+        plan->partition_type = 0x01;
+    } else if (plan->fat_type == 16) {
+        plan->partition_type = (plan->partition_sectors < 65536) ? 0x04 : 0x06;
+    } else {
+        plan->partition_type = (plan->partition_lba + plan->partition_sectors <= FORMAT_CHS_LIMIT) ? 0x0B : 0x0C;
+    }
+
+    return 0;
+}
+
+void fat_format_print_plan(const fat_format_geometry_t* geo, const fat_format_plan_t* plan) {
+    char size_str[32];
+
+    printf("\n=== FORMAT PLAN ===\n");
+    partition_display_format_size((uint64_t)geo->card_sectors * 512, size_str, sizeof(size_str));
+    printf("Card: %s (%u sectors)\n", size_str, geo->card_sectors);
+
+    if (geo->au_sectors > 0) {
+        printf("Allocation unit: %u KB", geo->au_sectors / 2);
+        if (geo->erase_size > 0) {
+            printf(", erase %u AUs per %u s (+%u s)", geo->erase_size,
+                   geo->erase_timeout, geo->erase_offset);
+        }
+        printf("\n");
+    } else {
+        printf("Allocation unit: not reported\n");
+    }
+
+    printf("Filesystem: FAT%u, %u KB clusters, %u clusters\n",
+           plan->fat_type, plan->sectors_per_cluster / 2, plan->cluster_count);
+    printf("Alignment boundary: %u sectors (%u KB)\n",
+           plan->boundary_sectors, plan->boundary_sectors / 2);
+    printf("Partition: LBA %u, %u sectors, type 0x%02X\n",
+           plan->partition_lba, plan->partition_sectors, plan->partition_type);
+    printf("Reserved: %u sectors, FATs: 2 x %u sectors", plan->reserved_sectors, plan->sectors_per_fat);
+    if (plan->root_entries > 0) {
+        printf(", root: %u entries", plan->root_entries);
+    }
+    printf("\n");
+    printf("Data region: LBA %u (%s)\n", plan->first_data_lba,
+           plan->first_data_lba % plan->boundary_sectors == 0 ? "aligned" : "MISALIGNED");
+}
+
+// Encode an LBA as CHS for the MBR, saturating beyond the CHS range
+static void fat_format_chs(uint32_t lba, uint8_t* chs) {
+    if (lba >= FORMAT_CHS_LIMIT) {
+        chs[0] = 0xFE;
+        chs[1] = 0xFF;
+        chs[2] = 0xFF;
+        return;
+    }
+
+    uint32_t cylinder = lba / (255 * 63);
+    uint32_t head = (lba / 63) % 255;
+    uint32_t sector = lba % 63 + 1;
+
+    chs[0] = head;
+    chs[1] = ((cylinder >> 2) & 0xC0) | sector;
+    chs[2] = cylinder & 0xFF;
+}
+
+static void fat_format_boot_sector(const fat_format_plan_t* plan, const char* label,
+                                   uint32_t serial, uint8_t* sector) {
+    bool fat32 = (plan->fat_type == 32);
+
+    sector[0] = 0xEB;
+    sector[1] = fat32 ? 0x58 : 0x3C;
+    sector[2] = 0x90;
+    memcpy(&sector[3], "MSWIN4.1", 8);
+
+    write_le16(&sector[11], 512);
+    sector[13] = plan->sectors_per_cluster;
+    write_le16(&sector[14], plan->reserved_sectors);
+    sector[16] = 2;
+    write_le16(&sector[17], plan->root_entries);
+    if (plan->partition_sectors < 65536 && !fat32) {
+        write_le16(&sector[19], plan->partition_sectors);
+    } else {
+        write_le32(&sector[32], plan->partition_sectors);
+    }
+    sector[21] = 0xF8;
+    write_le16(&sector[24], 63);
+    write_le16(&sector[26], 255);
+    write_le32(&sector[28], plan->partition_lba);
+
+    // Extended BPB sits after the FAT32 fields on FAT32 volumes
+    uint8_t* ext = &sector[36];
+    if (fat32) {
+        write_le32(&sector[36], plan->sectors_per_fat);
+        write_le32(&sector[44], 2);     // Root directory cluster
+        write_le16(&sector[48], 1);     // FSInfo sector
+        write_le16(&sector[50], 6);     // Backup boot sector
+        ext = &sector[64];
+    } else {
+        write_le16(&sector[22], plan->sectors_per_fat);
+    }
+
+    ext[0] = 0x80;                      // Drive number
+    ext[2] = 0x29;                      // Extended boot signature
+    write_le32(&ext[3], serial);
+    memcpy(&ext[7], label, 11);
+    memcpy(&ext[18], fat32 ? "FAT32   " : (plan->fat_type == 16 ? "FAT16   " : "FAT12   "), 8);
+
+    // Boot code just halts if the volume is ever booted
+    ext[26] = 0xF4;
+    ext[27] = 0xEB;
+    ext[28] = 0xFD;
+
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+}
+
+// Contents of one metadata sector; everything not set here is zero
+static void fat_format_fill_sector(const fat_format_plan_t* plan, uint32_t lba, const char* label,
+                                   uint32_t serial, uint8_t* sector) {
+    uint32_t part = plan->partition_lba;
+    bool fat32 = (plan->fat_type == 32);
+
+    memset(sector, 0, 512);
+
+    if (lba == 0) {
+        uint8_t* entry = &sector[446];
+        fat_format_chs(part, &entry[1]);
+        entry[4] = plan->partition_type;
+        fat_format_chs(part + plan->partition_sectors - 1, &entry[5]);
+        write_le32(&entry[8], part);
+        write_le32(&entry[12], plan->partition_sectors);
+        sector[510] = 0x55;
+        sector[511] = 0xAA;
+    } else if (lba == part || (fat32 && lba == part + 6)) {
+        fat_format_boot_sector(plan, label, serial, sector);
+    } else if (fat32 && (lba == part + 1 || lba == part + 7)) {
+        write_le32(&sector[0], 0x41615252);
+        write_le32(&sector[484], 0x61417272);
+        write_le32(&sector[488], plan->cluster_count - 1);  // Root holds one cluster
+        write_le32(&sector[492], 3);
+        write_le32(&sector[508], 0xAA550000);
+    } else if (lba == plan->fat_lba || lba == plan->fat_lba + plan->sectors_per_fat) {
+        // Media descriptor and end-of-chain in entries 0 and 1
+        if (fat32) {
+            write_le32(&sector[0], 0x0FFFFFF8);
+            write_le32(&sector[4], 0x0FFFFFFF);
+            write_le32(&sector[8], 0x0FFFFFFF);        // Root directory chain
+        } else if (plan->fat_type == 16) {
+            write_le32(&sector[0], 0xFFFFFFF8);
+        } else {
+            sector[0] = 0xF8;
+            sector[1] = 0xFF;
+            sector[2] = 0xFF;
+        }
+    } else if (lba == plan->fat_lba + 2 * plan->sectors_per_fat && memcmp(label, "NO NAME    ", 11) != 0) {
+        // First root directory sector (FAT32: first sector of cluster 2)
+        memcpy(sector, label, 11);
+        sector[11] = 0x08;              // Volume label attribute
+    }
+}
+
+int fat_format_write(const fat_format_plan_t* plan, const char* label) {
+    char volume_label[11];
+
+    // Labels are upper-case and space-padded to 11 characters
+    memset(volume_label, ' ', sizeof(volume_label));
+    if (label == NULL || label[0] == '\0') {
+        memcpy(volume_label, "NO NAME", 7);
+    } else {
+        for (int i = 0; i < 11 && label[i] != '\0'; i++) {
+            char c = label[i];
+            volume_label[i] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+        }
+    }
+
+    uint32_t serial = (uint32_t)time_us_64();
+    uint64_t start_us = time_us_64();
+
+    // Everything from the MBR up to and including the root directory is
+    // rewritten in chunks; chunks start on multiples of their size, so the
+    // writes never straddle an allocation unit
+    for (uint32_t lba = 0; lba < plan->metadata_sectors; lba += FAT_FORMAT_CHUNK_SECTORS) {
+        uint32_t count = plan->metadata_sectors - lba;
+        if (count > FAT_FORMAT_CHUNK_SECTORS) {
+            count = FAT_FORMAT_CHUNK_SECTORS;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            fat_format_fill_sector(plan, lba + i, volume_label, serial, &format_buffer[i * 512]);
+        }
+
+        if (sd_write_blocks(lba, count, format_buffer) != 0) {
+            printf("Format failed writing LBA %u\n", lba);
+            return -1;
+        }
+    }
+
+    uint32_t elapsed_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+    char size_str[32];
+    partition_display_format_size((uint64_t)plan->metadata_sectors * 512, size_str, sizeof(size_str));
+    printf("Wrote %s of metadata in %u ms\n", size_str, elapsed_ms);
+
+    return 0;
+}
+
+int fat_format_card(const char* label, bool confirm) {
+    fat_format_geometry_t geo;
+    fat_format_plan_t plan;
+
+    if (fat_format_read_geometry(&geo) != 0) {
+        printf("Could not read card geometry\n");
+        return -1;
+    }
+
+    int result = fat_format_plan(&geo, &plan);
+    if (result == -3) {
+        printf("Card is larger than 32 GB; SD cards of this size take exFAT\n");
+        return result;
+    }
+    if (result != 0) {
+        printf("No aligned FAT layout fits this card\n");
+        return result;
+    }
+
+    fat_format_print_plan(&geo, &plan);
+
+    if (!confirm) {
+        printf("Dry run only; the card was not written\n");
+        return 0;
+    }
+
+    printf("Formatting...\n");
+    return fat_format_write(&plan, label);
+}
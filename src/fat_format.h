@@ -0,0 +1,53 @@
+#ifndef FAT_FORMAT_H
+#define FAT_FORMAT_H
+
+#include "pico/stdlib.h"
+
+// Sectors written per multi-block write while laying down metadata (16 KB)
+#define FAT_FORMAT_CHUNK_SECTORS 32
+
+// Largest alignment boundary honoured; bigger AUs fall back to a divisor
+// so the reserved sector count still fits its 16-bit BPB field
+#define FAT_FORMAT_MAX_BOUNDARY 32768
+
+// Card geometry the layout is derived from
+typedef struct {
+    uint32_t card_sectors;
+    uint32_t au_sectors;        // Allocation unit from SD Status (0 = unknown)
+    uint16_t erase_size;        // AUs erased per erase timeout (0 = unknown)
+    uint8_t erase_timeout;      // Seconds for erase_size AUs
+    uint8_t erase_offset;       // Fixed erase overhead in seconds
+} fat_format_geometry_t;
+
+// Layout of a single-partition FAT card. All LBAs are absolute.
+typedef struct {
+    uint8_t fat_type;           // 12, 16 or 32
+    uint8_t partition_type;     // MBR system ID
+    uint8_t sectors_per_cluster;
+    uint16_t reserved_sectors;
+    uint16_t root_entries;      // FAT12/16 fixed root directory
+    uint32_t boundary_sectors;  // Data region and clusters align to this
+    uint32_t partition_lba;
+    uint32_t partition_sectors;
+    uint32_t sectors_per_fat;
+    uint32_t fat_lba;
+    uint32_t first_data_lba;
+    uint32_t cluster_count;
+    uint32_t metadata_sectors;  // Sectors written from LBA 0, root cluster included
+} fat_format_plan_t;
+
+// Read capacity, AU size and erase geometry from the card
+int fat_format_read_geometry(fat_format_geometry_t* geo);
+
+// Choose FAT type and cluster size per SD Association guidance for the
+// capacity and align the layout; -3 when the card needs exFAT
+int fat_format_plan(const fat_format_geometry_t* geo, fat_format_plan_t* plan);
+void fat_format_print_plan(const fat_format_geometry_t* geo, const fat_format_plan_t* plan);
+
+// Write MBR, boot sectors, FATs and root directory. Destroys card contents.
+int fat_format_write(const fat_format_plan_t* plan, const char* label);
+
+// Plan and print; only writes the card when confirm is set
+int fat_format_card(const char* label, bool confirm);
+
+#endif // FAT_FORMAT_H
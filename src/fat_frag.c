@@ -0,0 +1,319 @@
+#include "fat_frag.h"
+#include "fat_walk.h"
+#include "fat12.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <string.h>
+
+// A contiguous run of a chain that continues at a cluster other than the
+// one after its end; next is 0 when the run ends in a free, bad or
+// out-of-range entry
+typedef struct {
+    uint32_t start;
+    uint32_t next;
+} fat_frag_break_t;
+
+// Word-aligned chunk buffer for streaming the FAT
+static uint32_t frag_buf[FAT_FRAG_CHUNK_SECTORS * 512 / 4];
+
+// Breaks in FAT order, which is also ascending order of run start
+static fat_frag_break_t frag_breaks[FAT_FRAG_MAX_BREAKS];
+
+typedef struct {
+    fat_volume_t* vol;
+    fat_frag_report_t* report;
+    uint32_t cluster;           // Cluster of the next entry
+    uint32_t prev;              // Entry of the previous cluster
+    uint32_t run_start;         // First cluster of the run in progress
+    uint32_t known_below;       // Runs starting below this are all in the table
+} fat_frag_ctx_t;
+
+static void fat_frag_add_break(fat_frag_ctx_t* frag, uint32_t next) {
+    fat_frag_report_t* report = frag->report;
+
+    if (report->breaks >= FAT_FRAG_MAX_BREAKS) {
+        if (!report->breaks_overflow) {
+            report->breaks_overflow = true;
+            frag->known_below = frag->run_start;
+        }
+        return;
+    }
+
+    frag_breaks[report->breaks].start = frag->run_start;
+    frag_breaks[report->breaks].next = next;
+    report->breaks++;
+}
+
+// One FAT entry. A cluster starts a run unless the previous cluster
+// points to it; each cluster has one predecessor on a sound volume.
+static void fat_frag_scan_entry(fat_frag_ctx_t* frag, uint32_t value) {
+    const fat_volume_t* vol = frag->vol;
+    uint32_t cluster = frag->cluster++;
+    bool continued = (frag->prev == cluster);
+
+    frag->prev = value;
+    if (value == 0 || fat_volume_is_bad_cluster(vol, value)) {
+        if (continued) {
+            fat_frag_add_break(frag, 0); // Chain runs into a free or bad cluster
+        }
+        return;
+    }
+
+    if (!continued) {
+        frag->run_start = cluster;
+    }
+
+    if (fat_volume_is_end_of_chain(vol, value) ||
+        (value == cluster + 1 && fat_volume_is_data_cluster(vol, value))) {
+        return;
+    }
+
+    fat_frag_add_break(frag, fat_volume_is_data_cluster(vol, value) ? value : 0);
+}
+
+static int fat_frag_fat12_entries(uint32_t* words, uint32_t first_entry, uint32_t entries, void* ctx) {
+    fat_frag_ctx_t* frag = ctx;
+    const uint16_t* lanes = (const uint16_t*)words;
+
+    // Entries 0 and 1 carry the media byte, not cluster state
+    for (uint32_t i = (first_entry == 0) ? 2 : 0; i < entries; i++) {
+        fat_frag_scan_entry(frag, lanes[i] & 0xFFF);
+    }
+    return 0;
+}
+
+// Single streaming pass over FAT #1 collecting the chain breaks
+static int fat_frag_scan_fat(fat_frag_ctx_t* frag) {
+    fat_volume_t* vol = frag->vol;
+
+    frag->cluster = 2;
+    frag->prev = 0;
+    frag->run_start = 0;
+    frag->known_below = UINT32_MAX;
+
+    if (vol->fat_type == 12) {
+        return fat12_stream(vol, fat_frag_fat12_entries, frag);
+    }
+
+    bool fat32 = (vol->fat_type == 32);
+    uint32_t entry_count = vol->cluster_count + 2;
+    uint32_t entries_per_sector = 512 / (vol->fat_type / 8);
+
+    for (uint32_t sector = 0; sector < vol->fat_entry_sectors; sector += FAT_FRAG_CHUNK_SECTORS) {
+        uint32_t chunk = vol->fat_entry_sectors - sector;
+        if (chunk > FAT_FRAG_CHUNK_SECTORS) chunk = FAT_FRAG_CHUNK_SECTORS;
+
+        if (sd_read_blocks(vol->fat_lba + sector, chunk, (uint8_t*)frag_buf) != 0) {
+            return -1;
+        }
+
+        uint32_t first = sector * entries_per_sector;
+        uint32_t count = chunk * entries_per_sector;
+        if (count > entry_count - first) count = entry_count - first;
+
+        for (uint32_t i = (first == 0) ? 2 : 0; i < count; i++) {
+            fat_frag_scan_entry(frag, fat32 ? (frag_buf[i] & 0x0FFFFFFF) : ((const uint16_t*)frag_buf)[i]);
+        }
+    }
+
+    return 0;
+}
+
+// Follow a chain through the FAT window, counting its extents; used for
+// runs past a full break table. Negative for broken chains.
+static int fat_frag_follow_chain(fat_volume_t* vol, uint32_t first_cluster, uint32_t* fragments) {
+    uint32_t cluster = first_cluster;
+    uint32_t clusters = 0;
+    fat_extent_t extent;
+    int result;
+
+    *fragments = 0;
+    while ((result = fat_volume_next_extent(vol, &cluster, &extent)) > 0) {
+        (*fragments)++;
+        clusters += extent.cluster_count;
+        if (clusters > vol->cluster_count) {
+            return -5; // Chain loops back on itself
+        }
+    }
+
+    return result;
+}
+
+// Index of the break whose run starts at cluster, or -1
+static int fat_frag_find_break(uint32_t count, uint32_t cluster) {
+    uint32_t lo = 0;
+    uint32_t hi = count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (frag_breaks[mid].start < cluster) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < count && frag_breaks[lo].start == cluster) ? (int)lo : -1;
+}
+
+// A break must land on the first cluster of an allocated run; anything
+// else jumps to a free cluster or back into the middle of a chain
+static bool fat_frag_is_run_start(fat_volume_t* vol, uint32_t cluster) {
+    uint32_t value;
+    uint32_t prev;
+
+    if (fat_volume_get_entry(vol, cluster, &value) != 0 || value == 0 ||
+        fat_volume_is_bad_cluster(vol, value)) {
+        return false;
+    }
+    return cluster == 2 || (fat_volume_get_entry(vol, cluster - 1, &prev) == 0 && prev != cluster);
+}
+
+// Count the extents of a chain from the break table: a run with no break
+// ends the chain. Only the last run of a fragmented chain is checked in
+// the FAT, so a chain that jumps into another one counts as broken, while
+// one that starts inside another is left to fat_check.
+static int fat_frag_count_extents(fat_frag_ctx_t* frag, uint32_t first_cluster, uint32_t* fragments) {
+    uint32_t count = frag->report->breaks;
+    uint32_t cluster = first_cluster;
+
+    *fragments = 0;
+    for (uint32_t step = 0; step <= count; step++) {
+        (*fragments)++;
+
+        int i = fat_frag_find_break(count, cluster);
+        if (i < 0) {
+            if (step > 0 && !fat_frag_is_run_start(frag->vol, cluster)) {
+                return -5;
+            }
+            if (cluster < frag->known_below) {
+                return 0;
+            }
+
+            uint32_t rest;
+            int result = fat_frag_follow_chain(frag->vol, cluster, &rest);
+            if (result < 0) {
+                return result;
+            }
+            if (rest > 1) *fragments += rest - 1;
+            return 0;
+        }
+
+        if (frag_breaks[i].next == 0) {
+            return -5; // Broken chain
+        }
+        cluster = frag_breaks[i].next;
+    }
+
+    return -5; // Chain loops back on itself
+}
+
+static void fat_frag_record_worst(fat_frag_report_t* report, const char* dir_path,
+                                  const fat_dirent_t* ent, uint32_t fragments) {
+    uint32_t pos = report->worst_count;
+
+    // Keep the list sorted by fragment count, most fragmented first
+    while (pos > 0 && report->worst[pos - 1].fragments < fragments) {
+        if (pos < FAT_FRAG_TOP_FILES) {
+            report->worst[pos] = report->worst[pos - 1];
+        }
+        pos--;
+    }
+
+    if (pos >= FAT_FRAG_TOP_FILES) {
+        return;
+    }
+
+    fat_frag_file_t* file = &report->worst[pos];
+    file->fragments = fragments;
+    file->first_cluster = ent->first_cluster;
+    file->size = ent->size;
+    snprintf(file->path, sizeof(file->path), "%s%s%s",
+             dir_path, strcmp(dir_path, "/") == 0 ? "" : "/", ent->name);
+
+    if (report->worst_count < FAT_FRAG_TOP_FILES) {
+        report->worst_count++;
+    }
+}
+
+static void fat_frag_entry(const char* path, const fat_dirent_t* ent, void* ctx) {
+    fat_frag_ctx_t* frag = ctx;
+    fat_frag_report_t* report = frag->report;
+
+    if ((ent->attributes & FAT_ATTR_DIRECTORY) || ent->first_cluster == 0) {
+        return;
+    }
+
+    uint32_t fragments;
+    if (!fat_volume_is_data_cluster(frag->vol, ent->first_cluster) ||
+        fat_frag_count_extents(frag, ent->first_cluster, &fragments) < 0) {
+        report->chain_errors++;
+        return;
+    }
+
+    report->files++;
+    report->total_fragments += fragments;
+
+    if (fragments > 1) {
+        report->fragmented_files++;
+        fat_frag_record_worst(report, path, ent, fragments);
+    }
+}
+
+int fat_frag_analyze(fat_volume_t* vol, fat_frag_report_t* report) {
+    fat_frag_ctx_t ctx = {vol, report, 0, 0, 0, 0};
+    const fat_walk_visitor_t visitor = {
+        .enter_dir = NULL,
+        .entry = fat_frag_entry,
+        .dir_done = NULL,
+        .leave_dir = NULL,
+    };
+
+    memset(report, 0, sizeof(*report));
+
+    int result = fat_frag_scan_fat(&ctx);
+    if (result != 0) {
+        return result;
+    }
+    return fat_walk(vol, &visitor, &ctx);
+}
+
+void fat_frag_print(fat_volume_t* vol, const fat_frag_report_t* report) {
+    printf("\n  === Fragmentation ===\n");
+    printf("  Files with data: %u, fragmented: %u (%.1f%%)\n",
+           report->files, report->fragmented_files,
+           report->files ? report->fragmented_files * 100.0 / report->files : 0.0);
+    printf("  Extents: %u (%.2f per file)\n", report->total_fragments,
+           report->files ? (double)report->total_fragments / report->files : 0.0);
+
+    if (report->chain_errors > 0) {
+        printf("  Broken cluster chains: %u\n", report->chain_errors);
+    }
+    if (report->breaks_overflow) {
+        printf("  More than %u chain breaks; later chains were followed through the FAT\n",
+               FAT_FRAG_MAX_BREAKS);
+    }
+
+    if (report->worst_count == 0) {
+        return;
+    }
+
+    printf("  Most fragmented files:\n");
+    for (uint32_t i = 0; i < report->worst_count; i++) {
+        const fat_frag_file_t* file = &report->worst[i];
+        printf("  %6u extents %10u bytes  %s\n", file->fragments, file->size, file->path);
+
+        // Extent map: start LBA and length in sectors
+        uint32_t cluster = file->first_cluster;
+        fat_extent_t extent;
+        uint32_t shown = 0;
+        while (shown < FAT_FRAG_MAP_EXTENTS && fat_volume_next_extent(vol, &cluster, &extent) > 0) {
+            printf("      LBA %10u  %8u sectors\n",
+                   fat_volume_cluster_to_lba(vol, extent.first_cluster),
+                   extent.cluster_count * vol->sectors_per_cluster);
+            shown++;
+        }
+        if (file->fragments > shown) {
+            printf("      ... %u more extents\n", file->fragments - shown);
+        }
+    }
+}
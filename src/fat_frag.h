@@ -0,0 +1,37 @@
+#ifndef FAT_FRAG_H
+#define FAT_FRAG_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+
+#define FAT_FRAG_TOP_FILES   10
+#define FAT_FRAG_PATH_MAX    128
+#define FAT_FRAG_MAP_EXTENTS 8     // Extents printed per worst offender
+#define FAT_FRAG_CHUNK_SECTORS 16  // FAT sectors per multi-block read (8 KB)
+#define FAT_FRAG_MAX_BREAKS  2048  // Chain breaks kept from the FAT pass (16 KB)
+
+typedef struct {
+    uint32_t fragments;
+    uint32_t first_cluster;
+    uint32_t size;
+    char path[FAT_FRAG_PATH_MAX];
+} fat_frag_file_t;
+
+// Per-volume fragmentation summary, worst offenders sorted first
+typedef struct {
+    uint32_t files;             // Files with allocated clusters
+    uint32_t fragmented_files;
+    uint32_t total_fragments;
+    uint32_t chain_errors;
+    uint32_t breaks;            // Runs that continue somewhere other than the next cluster
+    bool breaks_overflow;       // Table filled; later chains were followed through the FAT
+    uint32_t worst_count;
+    fat_frag_file_t worst[FAT_FRAG_TOP_FILES];
+} fat_frag_report_t;
+
+// Stream the FAT once to find where chains jump, then walk the tree and
+// count each file's extents from that table
+int fat_frag_analyze(fat_volume_t* vol, fat_frag_report_t* report);
+void fat_frag_print(fat_volume_t* vol, const fat_frag_report_t* report);
+
+#endif // FAT_FRAG_H
@@ -0,0 +1,235 @@
+#include "fat_lfn.h"
+#include <string.h>
+
+// Byte offsets of the 13 UTF-16 code units within an LFN entry
+static const uint8_t lfn_offsets[13] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+
+void fat_lfn_reset(fat_lfn_t* lfn) {
+    lfn->expected = 0;
+    lfn->fragments = 0;
+    lfn->deleted = false;
+}
+
+static void fat_lfn_read_units(const uint8_t* entry, uint16_t* units) {
+    for (int j = 0; j < 13; j++) {
+        units[j] = entry[lfn_offsets[j]] | (entry[lfn_offsets[j] + 1] << 8);
+    }
+}
+
+void fat_lfn_add(fat_lfn_t* lfn, const uint8_t* entry, uint32_t index) {
+    uint8_t sequence = entry[0] & 0x3F;
+
+    if (sequence == 0 || sequence > FAT_LFN_MAX_FRAGMENTS) {
+        fat_lfn_reset(lfn);
+        return;
+    }
+
+    // The last fragment of a name is stored first on disk and starts the set
+    if (entry[0] & 0x40) {
+        lfn->fragments = sequence;
+        lfn->checksum = entry[13];
+        lfn->first_index = index;
+        lfn->deleted = false;
+    } else if (lfn->deleted || sequence != lfn->expected || entry[13] != lfn->checksum) {
+        fat_lfn_reset(lfn); // Orphan or out-of-order fragment
+        return;
+    }
+
+    fat_lfn_read_units(entry, &lfn->units[(sequence - 1) * 13]);
+    lfn->expected = sequence - 1;
+}
+
+void fat_lfn_add_deleted(fat_lfn_t* lfn, const uint8_t* entry, uint32_t index) {
+    if (!lfn->deleted || entry[13] != lfn->checksum ||
+        lfn->fragments >= FAT_LFN_MAX_FRAGMENTS) {
+        fat_lfn_reset(lfn);
+        lfn->deleted = true;
+        lfn->checksum = entry[13];
+        lfn->first_index = index;
+    }
+
+    fat_lfn_read_units(entry, &lfn->units[lfn->fragments * 13]);
+    lfn->fragments++;
+}
+
+uint8_t fat_lfn_checksum(const uint8_t* short_name) {
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++) {
+        sum = (uint8_t)(((sum & 1) << 7) + (sum >> 1) + short_name[i]);
+    }
+    return sum;
+}
+
+// Append one code point as UTF-8; returns false when it does not fit
+static bool fat_lfn_put_utf8(char* out, size_t out_size, size_t* len, uint32_t cp) {
+    uint8_t bytes[4];
+    size_t n;
+
+    if (cp < 0x80) {
+        bytes[0] = (uint8_t)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        bytes[0] = 0xC0 | (cp >> 6);
+        bytes[1] = 0x80 | (cp & 0x3F);
+        n = 2;
+    } else if (cp < 0x10000) {
+        bytes[0] = 0xE0 | (cp >> 12);
+        bytes[1] = 0x80 | ((cp >> 6) & 0x3F);
+        bytes[2] = 0x80 | (cp & 0x3F);
+        n = 3;
+    } else {
+        bytes[0] = 0xF0 | (cp >> 18);
+        bytes[1] = 0x80 | ((cp >> 12) & 0x3F);
+        bytes[2] = 0x80 | ((cp >> 6) & 0x3F);
+        bytes[3] = 0x80 | (cp & 0x3F);
+        n = 4;
+    }
+
+    // Truncate on a code point boundary, keeping room for the terminator
+    if (*len + n >= out_size) {
+        return false;
+    }
+
+    memcpy(out + *len, bytes, n);
+    *len += n;
+    return true;
+}
+
+int fat_lfn_utf16_to_utf8(const uint16_t* units, uint32_t count, char* out, size_t out_size) {
+    size_t len = 0;
+
+    if (out_size == 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t cp = units[i];
+        if (cp == 0x0000 || cp == 0xFFFF) {
+            break;
+        }
+
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < count &&
+            units[i + 1] >= 0xDC00 && units[i + 1] <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (units[i + 1] - 0xDC00);
+            i++;
+        } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+            cp = 0xFFFD; // Unpaired surrogate
+        }
+
+        if (!fat_lfn_put_utf8(out, out_size, &len, cp)) {
+            break;
+        }
+    }
+
+    out[len] = 0;
+    return (int)len;
+}
+
+int fat_lfn_utf8_to_utf16(const char* in, size_t len, uint16_t* units, uint32_t max_units) {
+    const uint8_t* p = (const uint8_t*)in;
+    uint32_t count = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        uint32_t cp = p[i];
+        uint32_t extra = 0;
+        uint32_t min = 0;
+
+        if (cp >= 0xF0 && cp <= 0xF4) {
+            cp &= 0x07;
+            extra = 3;
+            min = 0x10000;
+        } else if (cp >= 0xE0 && cp < 0xF0) {
+            cp &= 0x0F;
+            extra = 2;
+            min = 0x800;
+        } else if (cp >= 0xC2 && cp < 0xE0) {
+            cp &= 0x1F;
+            extra = 1;
+            min = 0x80;
+        } else if (cp >= 0x80) {
+            cp = 0xFFFD; // Stray continuation or invalid lead byte
+        }
+        i++;
+
+        for (uint32_t k = 0; k < extra; k++) {
+            if (i >= len || (p[i] & 0xC0) != 0x80) {
+                cp = 0xFFFD; // Truncated sequence; resume at this byte
+                break;
+            }
+            cp = (cp << 6) | (p[i++] & 0x3F);
+        }
+        if (cp != 0xFFFD && (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))) {
+            cp = 0xFFFD; // Overlong, out of range or an encoded surrogate
+        }
+
+        uint32_t need = cp >= 0x10000 ? 2 : 1;
+        if (count + need > max_units) {
+            return -1;
+        }
+        if (need == 2) {
+            cp -= 0x10000;
+            units[count++] = (uint16_t)(0xD800 + (cp >> 10));
+            units[count++] = (uint16_t)(0xDC00 + (cp & 0x3FF));
+        } else {
+            units[count++] = (uint16_t)cp;
+        }
+    }
+
+    return (int)count;
+}
+
+// Decode the first count code units of the set as UTF-8
+static int fat_lfn_decode(const fat_lfn_t* lfn, uint32_t count, char* out, size_t out_size) {
+    return fat_lfn_utf16_to_utf8(lfn->units, count, out, out_size);
+}
+
+int fat_lfn_finish(fat_lfn_t* lfn, const uint8_t* short_entry, char* out, size_t out_size) {
+    bool complete = lfn->fragments > 0 && lfn->expected == 0 && !lfn->deleted &&
+                    lfn->checksum == fat_lfn_checksum(short_entry);
+    uint32_t count = lfn->fragments * 13;
+
+    fat_lfn_reset(lfn);
+    if (!complete) {
+        return 0;
+    }
+
+    return fat_lfn_decode(lfn, count, out, out_size);
+}
+
+int fat_lfn_finish_deleted(fat_lfn_t* lfn, const uint8_t* short_entry, uint8_t* first_char,
+                           char* out, size_t out_size) {
+    uint32_t fragments = lfn->fragments;
+    bool deleted = lfn->deleted;
+    uint8_t name[11];
+
+    fat_lfn_reset(lfn);
+    if (!deleted || fragments == 0) {
+        return 0;
+    }
+
+    // Disk order is last fragment first: reverse the blocks into name order
+    for (uint32_t lo = 0, hi = fragments - 1; lo < hi; lo++, hi--) {
+        for (int j = 0; j < 13; j++) {
+            uint16_t tmp = lfn->units[lo * 13 + j];
+            lfn->units[lo * 13 + j] = lfn->units[hi * 13 + j];
+            lfn->units[hi * 13 + j] = tmp;
+        }
+    }
+
+    // The checksum's first step is sum = name[0] and every later step is a
+    // bijection, so exactly one first byte reproduces it
+    memcpy(name, short_entry, sizeof(name));
+    bool matched = false;
+    for (int c = 0x21; !matched && c < 0x100; c++) {
+        name[0] = (uint8_t)c;
+        matched = c != 0xE5 && fat_lfn_checksum(name) == lfn->checksum;
+    }
+
+    if (!matched) {
+        return 0; // No valid first character fits, so not this entry's set
+    }
+
+    *first_char = name[0];
+    return fat_lfn_decode(lfn, fragments * 13, out, out_size);
+}
@@ -0,0 +1,56 @@
+#ifndef FAT_LFN_H
+#define FAT_LFN_H
+
+#include "pico/stdlib.h"
+
+// A long name spans at most 20 entries of 13 UTF-16 code units
+#define FAT_LFN_MAX_FRAGMENTS 20
+#define FAT_LFN_MAX_UNITS     (FAT_LFN_MAX_FRAGMENTS * 13)
+
+// Long file name being assembled from the LFN entries preceding an 8.3
+// entry. Fragments are stored as raw UTF-16 and only decoded once the set
+// has been validated against the 8.3 entry it belongs to.
+typedef struct {
+    uint16_t units[FAT_LFN_MAX_UNITS];
+    uint8_t checksum;           // Checksum shared by every fragment of the set
+    uint8_t fragments;          // Fragments announced by the first entry
+    uint8_t expected;           // Sequence number of the next fragment (0 = none)
+    bool deleted;               // Set of deleted fragments, stored in disk order
+    uint32_t first_index;       // Directory index of the first fragment
+} fat_lfn_t;
+
+void fat_lfn_reset(fat_lfn_t* lfn);
+
+// Feed one LFN entry. Fragments that do not continue the current set in
+// order start over or are dropped as orphans.
+void fat_lfn_add(fat_lfn_t* lfn, const uint8_t* entry, uint32_t index);
+
+// Close the set with its 8.3 entry. Writes the name as UTF-8 into out and
+// returns its length, or 0 when there is no complete set whose checksum
+// matches the 8.3 name. The set is reset either way.
+int fat_lfn_finish(fat_lfn_t* lfn, const uint8_t* short_entry, char* out, size_t out_size);
+
+// Deleted sets have lost their sequence bytes to the 0xE5 marker, so
+// fragments are kept in disk order and matched purely by checksum. The
+// 8.3 entry's first character is lost too: finishing takes the one byte
+// that reproduces the checksum. Some byte nearly always does, so this is
+// no proof the fragments belong to the entry; only sets whose byte falls
+// outside the valid 8.3 characters are dropped.
+void fat_lfn_add_deleted(fat_lfn_t* lfn, const uint8_t* entry, uint32_t index);
+int fat_lfn_finish_deleted(fat_lfn_t* lfn, const uint8_t* short_entry, uint8_t* first_char,
+                           char* out, size_t out_size);
+
+// Decode UTF-16 code units as UTF-8, stopping at 0x0000 or 0xFFFF.
+// Unpaired surrogates become U+FFFD; output is truncated on a code
+// point boundary. Returns the length written.
+int fat_lfn_utf16_to_utf8(const uint16_t* units, uint32_t count, char* out, size_t out_size);
+
+// Encode len bytes of UTF-8 as UTF-16, with surrogate pairs above U+FFFF.
+// Malformed sequences become U+FFFD. Returns the number of code units, or
+// -1 if they do not fit in max_units.
+int fat_lfn_utf8_to_utf16(const char* in, size_t len, uint16_t* units, uint32_t max_units);
+
+// Checksum of the 11-byte 8.3 name, as stored in each LFN entry
+uint8_t fat_lfn_checksum(const uint8_t* short_name);
+
+#endif // FAT_LFN_H
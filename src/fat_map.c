@@ -0,0 +1,224 @@
+#include "fat_map.h"
+#include "fat12.h"
+#include "partition_display.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <string.h>
+
+// Word-aligned chunk buffer for streaming the FAT
+static uint32_t map_buf[FAT_MAP_CHUNK_SECTORS * 512 / 4];
+
+// Cell glyphs by share of used clusters: free, <25%, <50%, <75%, <100%, full
+static const char map_ramp[] = ".:-=+#";
+
+typedef struct {
+    fat_map_t* map;
+    uint32_t cluster;           // Cluster number of the next entry
+    uint32_t cell;
+    uint32_t cell_end;          // First cluster of the following cell
+    uint32_t run;               // Length of the free run in progress
+} fat_map_scan_t;
+
+static inline void map_advance_cell(fat_map_scan_t* s) {
+    while (s->cluster >= s->cell_end) {
+        s->cell++;
+        s->cell_end += s->map->clusters_per_cell;
+    }
+}
+
+static inline void map_close_run(fat_map_scan_t* s) {
+    if (s->run > s->map->largest_free_run) {
+        s->map->largest_free_run = s->run;
+    }
+    s->run = 0;
+}
+
+// Account entries [cluster, cluster + count) known to be free in one step
+static void map_add_free(fat_map_scan_t* s, uint32_t count) {
+    if (s->run == 0) {
+        map_advance_cell(s);
+        s->map->cells[s->cell].free_runs++;
+        s->map->free_runs++;
+    }
+    s->run += count;
+    s->cluster += count;
+}
+
+static void map_add_entry(fat_map_scan_t* s, uint32_t value, uint32_t bad, uint32_t reserved_min) {
+    if (value == 0) {
+        map_add_free(s, 1);
+        return;
+    }
+
+    map_close_run(s);
+    map_advance_cell(s);
+
+    fat_map_cell_t* cell = &s->map->cells[s->cell];
+    if (value == bad) {
+        cell->bad++;
+    } else if (value == 1 || (value >= reserved_min && value < bad)) {
+        cell->reserved++;
+    } else {
+        cell->used++;
+    }
+    s->cluster++;
+}
+
+// Classify entries [i, count) of a buffer of FAT16 or FAT32 words
+static void map_scan_entries(fat_map_scan_t* s, const uint32_t* buf, uint32_t i, uint32_t count,
+                             bool fat32, uint32_t bad, uint32_t reserved_min) {
+    while (i < count) {
+        // Whole zero words are free clusters, so empty stretches of the
+        // FAT cost one compare per word
+        uint32_t word = (fat32 ? i : i / 2);
+        if ((fat32 || (i & 1) == 0) && i + (fat32 ? 1 : 2) <= count && buf[word] == 0) {
+            uint32_t n = 0;
+            uint32_t words = fat32 ? count - i : (count - i) / 2;
+            while (n < words && buf[word + n] == 0) n++;
+            n *= fat32 ? 1 : 2;
+            map_add_free(s, n);
+            i += n;
+            continue;
+        }
+
+        uint32_t value = fat32 ? (buf[i] & 0x0FFFFFFF) : ((const uint16_t*)buf)[i];
+        map_add_entry(s, value, bad, reserved_min);
+        i++;
+    }
+}
+
+static int map_fat12_entries(uint32_t* words, uint32_t first_entry, uint32_t entries, void* ctx) {
+    fat_map_scan_t* scan = (fat_map_scan_t*)ctx;
+
+    // Entries 0 and 1 carry the media byte, not cluster state
+    uint32_t i = 0;
+    if (first_entry == 0) {
+        i = 2;
+        scan->cluster = 2;
+    }
+
+    map_scan_entries(scan, words, i, entries, false, 0xFF7, 0xFF0);
+    return 0;
+}
+
+int fat_map_build(fat_volume_t* vol, fat_map_t* map) {
+    memset(map, 0, sizeof(*map));
+
+    map->cluster_count = vol->cluster_count;
+    map->clusters_per_cell = (vol->cluster_count + FAT_MAP_CELLS - 1) / FAT_MAP_CELLS;
+    map->cell_count = (vol->cluster_count + map->clusters_per_cell - 1) / map->clusters_per_cell;
+    map->system_sectors = vol->first_data_lba - vol->start_lba;
+
+    fat_map_scan_t scan = {map, 0, 0, 2 + map->clusters_per_cell, 0};
+    uint64_t start_us = time_us_64();
+
+    if (vol->fat_type == 12) {
+        int result = fat12_stream(vol, map_fat12_entries, &scan);
+        if (result != 0) {
+            return result;
+        }
+    } else {
+        bool fat32 = (vol->fat_type == 32);
+        uint32_t bad = fat32 ? 0x0FFFFFF7 : 0xFFF7;
+        uint32_t reserved_min = fat32 ? 0x0FFFFFF0 : 0xFFF0;
+        uint32_t entry_count = vol->cluster_count + 2;
+        uint32_t entries_per_sector = 512 / (vol->fat_type / 8);
+        uint32_t fat_sectors = vol->fat_entry_sectors;
+
+        for (uint32_t sector = 0; sector < fat_sectors; sector += FAT_MAP_CHUNK_SECTORS) {
+            uint32_t chunk = fat_sectors - sector;
+            if (chunk > FAT_MAP_CHUNK_SECTORS) chunk = FAT_MAP_CHUNK_SECTORS;
+
+            if (sd_read_blocks(vol->fat_lba + sector, chunk, (uint8_t*)map_buf) != 0) {
+                return -1;
+            }
+
+            uint32_t first = sector * entries_per_sector;
+            uint32_t count = chunk * entries_per_sector;
+            if (count > entry_count - first) count = entry_count - first;
+
+            // Entries 0 and 1 carry the media byte, not cluster state
+            uint32_t i = 0;
+            if (first == 0) {
+                i = 2;
+                scan.cluster = 2;
+            }
+
+            map_scan_entries(&scan, map_buf, i, count, fat32, bad, reserved_min);
+        }
+    }
+    map_close_run(&scan);
+
+    for (uint32_t c = 0; c < map->cell_count; c++) {
+        map->used += map->cells[c].used;
+        map->bad += map->cells[c].bad;
+        map->reserved += map->cells[c].reserved;
+    }
+    map->free = map->cluster_count - map->used - map->bad - map->reserved;
+    map->map_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+
+    return 0;
+}
+
+// Clusters covered by cell c; the last cell may be partial
+static uint32_t map_cell_size(const fat_map_t* map, uint32_t c) {
+    uint32_t start = c * map->clusters_per_cell;
+    uint32_t size = map->cluster_count - start;
+    return size < map->clusters_per_cell ? size : map->clusters_per_cell;
+}
+
+static char map_cell_glyph(const fat_map_t* map, uint32_t c) {
+    const fat_map_cell_t* cell = &map->cells[c];
+    uint32_t size = map_cell_size(map, c);
+
+    if (cell->bad > 0) return 'B';
+    if (cell->reserved > 0) return 'R';
+    if (cell->used == 0) return map_ramp[0];
+    if (cell->used == size) return map_ramp[5];
+    return map_ramp[1 + (cell->used * 4) / size];
+}
+
+static char map_runs_glyph(const fat_map_t* map, uint32_t c) {
+    uint32_t runs = map->cells[c].free_runs;
+
+    if (runs == 0) return ' ';
+    if (runs < 10) return '0' + runs;
+    return '+';
+}
+
+void fat_map_print(const fat_volume_t* vol, const fat_map_t* map) {
+    char cell_str[32];
+    char run_str[32];
+    uint32_t cluster_bytes = fat_volume_cluster_bytes(vol);
+    char line[FAT_MAP_COLUMNS + 1];
+
+    partition_display_format_size((uint64_t)map->clusters_per_cell * cluster_bytes, cell_str, sizeof(cell_str));
+    partition_display_format_size((uint64_t)map->largest_free_run * cluster_bytes, run_str, sizeof(run_str));
+
+    printf("\n  === Allocation map (FAT%u) ===\n", vol->fat_type);
+    printf("  System area: %u sectors (reserved, FATs%s)\n", map->system_sectors,
+           vol->fat_type == 32 ? "" : ", root");
+    printf("  %u clusters (%s) per cell; '.' free, ':' '-' '=' '+' partly used, '#' full, B bad, R reserved\n",
+           map->clusters_per_cell, cell_str);
+
+    // Each row of cells is followed by the number of free runs that start in
+    // each cell, so scattered free space shows up as a row of digits
+    for (uint32_t row = 0; row < map->cell_count; row += FAT_MAP_COLUMNS) {
+        uint32_t n = map->cell_count - row;
+        if (n > FAT_MAP_COLUMNS) n = FAT_MAP_COLUMNS;
+
+        for (uint32_t c = 0; c < n; c++) line[c] = map_cell_glyph(map, row + c);
+        line[n] = '\0';
+        printf("  %10u |%s|\n", 2 + row * map->clusters_per_cell, line);
+
+        for (uint32_t c = 0; c < n; c++) line[c] = map_runs_glyph(map, row + c);
+        printf("  %10s  %s\n", "free runs", line);
+    }
+
+    printf("  Used: %u, free: %u, bad: %u, reserved: %u clusters\n",
+           map->used, map->free, map->bad, map->reserved);
+    printf("  Free space in %u runs, largest %u clusters (%s), average %u clusters\n",
+           map->free_runs, map->largest_free_run, run_str,
+           map->free_runs ? map->free / map->free_runs : 0);
+    printf("  FAT mapped in %u ms\n", map->map_ms);
+}
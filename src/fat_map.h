@@ -0,0 +1,42 @@
+#ifndef FAT_MAP_H
+#define FAT_MAP_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+
+// Cells in the map, printed FAT_MAP_COLUMNS to a row
+#define FAT_MAP_CELLS   256
+#define FAT_MAP_COLUMNS 64
+
+// FAT sectors fetched per multi-block read while streaming the table (8 KB)
+#define FAT_MAP_CHUNK_SECTORS 16
+
+// Cluster states counted in each cell
+typedef struct {
+    uint32_t used;
+    uint32_t bad;
+    uint32_t reserved;          // FAT values reserved by the spec (xFF0-xFF6, 1)
+    uint32_t free_runs;         // Free runs starting in this cell
+} fat_map_cell_t;
+
+// Allocation map of one volume: fixed-size buckets of consecutive clusters
+typedef struct {
+    uint32_t cluster_count;
+    uint32_t clusters_per_cell;
+    uint32_t cell_count;
+    uint32_t system_sectors;    // Reserved sectors, FATs and fixed root
+    uint32_t used;
+    uint32_t free;
+    uint32_t bad;
+    uint32_t reserved;
+    uint32_t free_runs;
+    uint32_t largest_free_run;
+    uint32_t map_ms;
+    fat_map_cell_t cells[FAT_MAP_CELLS];
+} fat_map_t;
+
+// One streaming pass over FAT #1
+int fat_map_build(fat_volume_t* vol, fat_map_t* map);
+void fat_map_print(const fat_volume_t* vol, const fat_map_t* map);
+
+#endif // FAT_MAP_H
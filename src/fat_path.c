@@ -0,0 +1,212 @@
+#include "fat_path.h"
+#include <stdio.h>
+#include <string.h>
+
+static fat_path_cache_entry_t path_cache[FAT_PATH_CACHE_SETS][FAT_PATH_CACHE_WAYS];
+static const fat_volume_t* cache_vol;
+static uint32_t cache_start_lba;
+static uint32_t cache_clock;
+static uint32_t cache_hits;
+static uint32_t cache_misses;
+
+void fat_path_cache_reset(void) {
+    memset(path_cache, 0, sizeof(path_cache));
+    cache_vol = NULL;
+    cache_clock = 0;
+}
+
+void fat_path_print_cache_stats(void) {
+    printf("Path cache: %u hits, %u misses (%u slots)\n",
+           cache_hits, cache_misses, FAT_PATH_CACHE_SETS * FAT_PATH_CACHE_WAYS);
+}
+
+// Upper-case the ASCII letters of a component into key; FNV-1a over the result
+static uint32_t fat_path_make_key(const char* name, size_t len, char* key) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        char c = (name[i] >= 'a' && name[i] <= 'z') ? name[i] - 32 : name[i];
+        key[i] = c;
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    key[len] = 0;
+    return hash;
+}
+
+static fat_path_cache_entry_t* fat_path_cache_find(uint32_t parent, uint32_t hash, const char* key) {
+    fat_path_cache_entry_t* set = path_cache[(hash ^ parent) % FAT_PATH_CACHE_SETS];
+
+    for (int way = 0; way < FAT_PATH_CACHE_WAYS; way++) {
+        fat_path_cache_entry_t* slot = &set[way];
+        if (slot->stamp != 0 && slot->hash == hash && slot->parent_cluster == parent &&
+            strcmp(slot->key, key) == 0) {
+            slot->stamp = ++cache_clock;
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static void fat_path_cache_insert(uint32_t parent, uint32_t hash, const char* key,
+                                  const fat_dirent_t* ent) {
+    fat_path_cache_entry_t* set = path_cache[(hash ^ parent) % FAT_PATH_CACHE_SETS];
+    fat_path_cache_entry_t* victim = &set[0];
+
+    // Least recently used way, empty slots first
+    for (int way = 1; way < FAT_PATH_CACHE_WAYS; way++) {
+        if (set[way].stamp < victim->stamp) {
+            victim = &set[way];
+        }
+    }
+
+    victim->parent_cluster = parent;
+    victim->hash = hash;
+    victim->stamp = ++cache_clock;
+    strcpy(victim->key, key);
+    strcpy(victim->name, ent->name);
+    strcpy(victim->short_name, ent->short_name);
+    victim->attributes = ent->attributes;
+    victim->size = ent->size;
+    victim->first_cluster = ent->first_cluster;
+    victim->mod_date = ent->mod_date;
+    victim->mod_time = ent->mod_time;
+    victim->index = ent->index;
+    victim->set_index = ent->set_index;
+}
+
+static void fat_path_from_cache(const fat_path_cache_entry_t* slot, fat_dirent_t* ent) {
+    strcpy(ent->name, slot->name);
+    strcpy(ent->short_name, slot->short_name);
+    ent->attributes = slot->attributes;
+    ent->size = slot->size;
+    ent->first_cluster = slot->first_cluster;
+    ent->mod_date = slot->mod_date;
+    ent->mod_time = slot->mod_time;
+    ent->index = slot->index;
+    ent->set_index = slot->set_index;
+    ent->deleted = false;
+}
+
+// Look one component up in a directory, through the cache
+static int fat_path_lookup(fat_volume_t* vol, uint32_t dir_cluster, const char* name, size_t len,
+                           fat_dirent_t* ent) {
+    char key[FAT_PATH_CACHE_NAME];
+    bool cacheable = len < FAT_PATH_CACHE_NAME;
+    uint32_t hash = cacheable ? fat_path_make_key(name, len, key) : 0;
+    fat_path_cache_entry_t* slot = cacheable ? fat_path_cache_find(dir_cluster, hash, key) : NULL;
+
+    if (slot) {
+        cache_hits++;
+        fat_path_from_cache(slot, ent);
+        return 0;
+    }
+
+    cache_misses++;
+    int result = fat_dir_find(vol, dir_cluster, name, len, ent);
+    if (result <= 0) {
+        return result < 0 ? result : -7; // Not found
+    }
+    if (cacheable && strlen(ent->name) < FAT_PATH_CACHE_NAME) {
+        fat_path_cache_insert(dir_cluster, hash, key, ent);
+    }
+    return 0;
+}
+
+// Components walked so far, so that ".." can step back to the parent
+static struct {
+    const char* name;
+    size_t len;
+    uint32_t dir_cluster;           // Directory the component was found in
+} path_levels[FAT_PATH_MAX_DEPTH];
+
+int fat_path_resolve(fat_volume_t* vol, const char* path, fat_dirent_t* ent) {
+    uint32_t dir_cluster = 0;
+    uint32_t depth = 0;
+
+    if (cache_vol != vol || cache_start_lba != vol->start_lba) {
+        fat_path_cache_reset();
+        cache_vol = vol;
+        cache_start_lba = vol->start_lba;
+    }
+
+    while (*path) {
+        while (*path == '/') path++;
+        if (*path == 0) break;
+
+        const char* end = path;
+        while (*end && *end != '/') end++;
+        size_t len = end - path;
+
+        if (depth > 0 && !(ent->attributes & FAT_ATTR_DIRECTORY)) {
+            return -6; // Path continues below a file
+        }
+
+        int result = 0;
+        if (len == 1 && path[0] == '.') {
+            // Stays where it is
+        } else if (len == 2 && path[0] == '.' && path[1] == '.') {
+            // The root is its own parent; otherwise look the parent up again
+            if (depth > 0) {
+                depth--;
+            }
+            if (depth > FAT_PATH_MAX_DEPTH) {
+                return -8;
+            }
+            if (depth == 0) {
+                dir_cluster = 0;
+            } else {
+                result = fat_path_lookup(vol, path_levels[depth - 1].dir_cluster,
+                                         path_levels[depth - 1].name, path_levels[depth - 1].len, ent);
+                dir_cluster = ent->first_cluster;
+            }
+        } else {
+            result = fat_path_lookup(vol, dir_cluster, path, len, ent);
+            if (depth < FAT_PATH_MAX_DEPTH) {
+                path_levels[depth].name = path;
+                path_levels[depth].len = len;
+                path_levels[depth].dir_cluster = dir_cluster;
+            }
+            depth++;
+            dir_cluster = ent->first_cluster;
+        }
+        if (result != 0) {
+            return result;
+        }
+
+        path = end;
+    }
+
+    if (depth == 0) {
+        memset(ent, 0, sizeof(*ent));
+        strcpy(ent->name, "/");
+        strcpy(ent->short_name, "/");
+        ent->attributes = FAT_ATTR_DIRECTORY;
+    }
+
+    return 0;
+}
+
+int fat_path_print(fat_volume_t* vol, const char* path) {
+    static fat_dirent_t ent;
+
+    int result = fat_path_resolve(vol, path, &ent);
+    switch (result) {
+        case 0:
+            fat_dir_print_entry(&ent);
+            break;
+        case -7:
+            printf("  %s: not found\n", path);
+            break;
+        case -6:
+            printf("  %s: not a directory\n", path);
+            break;
+        case -8:
+            printf("  %s: too deep to step back with ..\n", path);
+            break;
+        default:
+            printf("  %s: lookup failed (error %d)\n", path, result);
+            break;
+    }
+
+    return result;
+}
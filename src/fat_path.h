@@ -0,0 +1,49 @@
+#ifndef FAT_PATH_H
+#define FAT_PATH_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+#include "fat_dir.h"
+
+// Directory-entry cache: set-associative, keyed by parent cluster and name
+#define FAT_PATH_CACHE_SETS 16
+#define FAT_PATH_CACHE_WAYS 4
+#define FAT_PATH_CACHE_NAME 40      // Longer names are looked up uncached
+
+// One resolved path component
+typedef struct {
+    uint32_t parent_cluster;
+    uint32_t hash;
+    uint32_t stamp;                 // Last use, 0 = empty slot
+    char key[FAT_PATH_CACHE_NAME];  // Component as looked up, upper-cased
+    char name[FAT_PATH_CACHE_NAME]; // Name as stored on disk
+    char short_name[13];
+    uint8_t attributes;
+    uint32_t size;
+    uint32_t first_cluster;
+    uint16_t mod_date;
+    uint16_t mod_time;
+    uint32_t index;
+    uint32_t set_index;
+} fat_path_cache_entry_t;
+
+// Deepest path whose components ".." can step back through
+#define FAT_PATH_MAX_DEPTH 32
+
+// Resolve an absolute path to its directory entry. The root itself resolves
+// to a directory entry with cluster 0. "." stays in the current directory and
+// ".." steps back to its parent, or stays at the root. Names are matched with
+// ASCII-only case folding: other characters must match exactly, so
+// "ÜNÏCÖDÉ NAÏVE.TXT" does not find "Ünïcödé naïve.txt". Returns 0, -7 if a
+// component does not exist, -6 if the path continues below a file, -8 if ".."
+// steps back from deeper than FAT_PATH_MAX_DEPTH, or a read error.
+int fat_path_resolve(fat_volume_t* vol, const char* path, fat_dirent_t* ent);
+
+// Drop all cached entries (after writes, or when switching volumes)
+void fat_path_cache_reset(void);
+void fat_path_print_cache_stats(void);
+
+// Print one path in 'ls -l' style, or why it could not be resolved
+int fat_path_print(fat_volume_t* vol, const char* path);
+
+#endif // FAT_PATH_H
@@ -0,0 +1,250 @@
+#include "fat_sort.h"
+#include "fat_dir.h"
+#include "fat_path.h"
+#include <stdio.h>
+#include <string.h>
+
+static fat_sort_record_t sort_arena[FAT_SORT_ARENA_RECORDS];
+static fat_dir_iter_t sort_iter;
+static fat_dirent_t sort_entry;
+
+// Full names re-read for records whose name keys tie. The record being
+// placed takes part in every comparison of a sift, so two slots keep most
+// tie-breaks to a single read.
+typedef struct {
+    bool valid;
+    uint32_t set_index;
+    char name[FAT_DIR_NAME_MAX];
+} fat_sort_name_t;
+
+static fat_volume_t* sort_vol;
+static uint32_t sort_dir_cluster;
+static fat_dir_iter_t sort_name_iter;
+static fat_dirent_t sort_name_entry;
+static fat_sort_name_t sort_names[2];
+static uint32_t sort_names_next;
+
+static void fat_sort_make_record(const fat_dirent_t* ent, int order, fat_sort_record_t* rec) {
+    switch (order & ~FAT_SORT_REVERSE) {
+        case FAT_SORT_SIZE:
+            rec->key = (ent->attributes & FAT_ATTR_DIRECTORY) ? 0 : ent->size;
+            break;
+        case FAT_SORT_TIME:
+            rec->key = ((uint32_t)ent->mod_date << 16) | ent->mod_time;
+            break;
+        default:
+            rec->key = 0;
+            break;
+    }
+
+    size_t i = 0;
+    for (; i < FAT_SORT_NAME_KEY && ent->name[i] != 0; i++) {
+        char c = ent->name[i];
+        rec->name[i] = (c >= 'a' && c <= 'z') ? c - 32 : c;
+    }
+    for (; i < FAT_SORT_NAME_KEY; i++) {
+        rec->name[i] = 0;
+    }
+
+    rec->set_index = ent->set_index;
+    rec->index = ent->index;
+}
+
+// Full name of a record's entry, or NULL when it cannot be re-read
+static const char* fat_sort_full_name(const fat_sort_record_t* rec) {
+    for (int i = 0; i < 2; i++) {
+        if (sort_names[i].valid && sort_names[i].set_index == rec->set_index) {
+            sort_names_next = i ^ 1; // Keep this one for the other side
+            return sort_names[i].name;
+        }
+    }
+
+    fat_dir_open(&sort_name_iter, sort_vol, sort_dir_cluster);
+    if (fat_dir_seek(&sort_name_iter, rec->set_index) != 0 ||
+        fat_dir_next(&sort_name_iter, &sort_name_entry) <= 0 ||
+        sort_name_entry.index != rec->index) {
+        return NULL;
+    }
+
+    fat_sort_name_t* slot = &sort_names[sort_names_next];
+    sort_names_next ^= 1;
+    slot->valid = true;
+    slot->set_index = rec->set_index;
+    strcpy(slot->name, sort_name_entry.name);
+    return slot->name;
+}
+
+// Compare full names the way the name keys are built, past the key
+static int fat_sort_compare_full(const fat_sort_record_t* a, const fat_sort_record_t* b) {
+    const char* name_a = fat_sort_full_name(a);
+    const char* name_b = name_a ? fat_sort_full_name(b) : NULL;
+    if (!name_a || !name_b) {
+        return 0;
+    }
+
+    for (size_t i = FAT_SORT_NAME_KEY; ; i++) {
+        char ca = (name_a[i] >= 'a' && name_a[i] <= 'z') ? name_a[i] - 32 : name_a[i];
+        char cb = (name_b[i] >= 'a' && name_b[i] <= 'z') ? name_b[i] - 32 : name_b[i];
+        if (ca != cb || ca == 0) {
+            return (unsigned char)ca - (unsigned char)cb;
+        }
+    }
+}
+
+// Negative when a is listed before b. Size and time put the largest and
+// newest first, ties are broken by name and then by position on disk, so
+// every entry has a distinct place in the order.
+static int fat_sort_compare(const fat_sort_record_t* a, const fat_sort_record_t* b, int order) {
+    int result = 0;
+
+    if (a->key != b->key) {
+        result = (a->key > b->key) ? -1 : 1;
+    } else {
+        result = memcmp(a->name, b->name, FAT_SORT_NAME_KEY);
+        // Equal full keys with no terminator: the names may go on differently
+        if (result == 0 && a->name[FAT_SORT_NAME_KEY - 1] != 0 && a->set_index != b->set_index) {
+            result = fat_sort_compare_full(a, b);
+        }
+        if (result == 0) {
+            result = (a->set_index < b->set_index) ? -1 : (a->set_index > b->set_index);
+        }
+    }
+
+    return (order & FAT_SORT_REVERSE) ? -result : result;
+}
+
+// Max-heap on the listing order: the root is the record listed last
+static void fat_sort_sift_down(uint32_t pos, uint32_t count, int order) {
+    fat_sort_record_t rec = sort_arena[pos];
+
+    for (;;) {
+        uint32_t child = pos * 2 + 1;
+        if (child >= count) break;
+        if (child + 1 < count && fat_sort_compare(&sort_arena[child + 1], &sort_arena[child], order) > 0) {
+            child++;
+        }
+        if (fat_sort_compare(&sort_arena[child], &rec, order) <= 0) break;
+        sort_arena[pos] = sort_arena[child];
+        pos = child;
+    }
+
+    sort_arena[pos] = rec;
+}
+
+static void fat_sort_sift_up(uint32_t pos, int order) {
+    fat_sort_record_t rec = sort_arena[pos];
+
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) / 2;
+        if (fat_sort_compare(&sort_arena[parent], &rec, order) >= 0) break;
+        sort_arena[pos] = sort_arena[parent];
+        pos = parent;
+    }
+
+    sort_arena[pos] = rec;
+}
+
+// Select the first arena-full of records that come after `last` in the
+// listing order. Sets *more when records beyond the selection remain.
+static int fat_sort_select(uint32_t dir_cluster, fat_volume_t* vol, int order,
+                           const fat_sort_record_t* last, uint32_t* count, bool* more) {
+    fat_sort_record_t rec;
+    int result;
+
+    *count = 0;
+    *more = false;
+
+    fat_dir_open(&sort_iter, vol, dir_cluster);
+    while ((result = fat_dir_next(&sort_iter, &sort_entry)) > 0) {
+        fat_sort_make_record(&sort_entry, order, &rec);
+
+        if (last && fat_sort_compare(&rec, last, order) <= 0) {
+            continue; // Listed in an earlier pass
+        }
+
+        if (*count < FAT_SORT_ARENA_RECORDS) {
+            sort_arena[*count] = rec;
+            fat_sort_sift_up((*count)++, order);
+            continue;
+        }
+
+        // Arena full: keep rec only if it comes before the current last one
+        *more = true;
+        if (fat_sort_compare(&rec, &sort_arena[0], order) < 0) {
+            sort_arena[0] = rec;
+            fat_sort_sift_down(0, *count, order);
+        }
+    }
+
+    return result;
+}
+
+int fat_sort_list(fat_volume_t* vol, const char* path, int order) {
+    static fat_dirent_t dir;
+    static fat_sort_record_t last;
+    uint32_t files = 0, count = 0, passes = 0;
+    uint64_t bytes = 0;
+    bool more;
+
+    int result = fat_path_resolve(vol, path, &dir);
+    if (result == 0 && !(dir.attributes & FAT_ATTR_DIRECTORY)) {
+        result = -6;
+    }
+    if (result != 0) {
+        printf("  %s: cannot list (error %d)\n", path, result);
+        return result;
+    }
+
+    sort_vol = vol;
+    sort_dir_cluster = dir.first_cluster;
+    sort_names[0].valid = false;
+    sort_names[1].valid = false;
+
+    static const char* const order_names[] = {"name", "size", "time"};
+    printf("\n  === Directory listing for %s (by %s%s) ===\n", path,
+           order_names[(order & ~FAT_SORT_REVERSE) % 3],
+           (order & FAT_SORT_REVERSE) ? ", reversed" : "");
+
+    do {
+        result = fat_sort_select(dir.first_cluster, vol, order, passes ? &last : NULL, &count, &more);
+        if (result < 0) break;
+        passes++;
+
+        // Heap sort in place: repeatedly move the last-listed record to the end
+        for (uint32_t n = count; n > 1; n--) {
+            fat_sort_record_t top = sort_arena[0];
+            sort_arena[0] = sort_arena[n - 1];
+            sort_arena[n - 1] = top;
+            fat_sort_sift_down(0, n - 1, order);
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            fat_dir_open(&sort_iter, vol, dir.first_cluster);
+            if (fat_dir_seek(&sort_iter, sort_arena[i].set_index) != 0 ||
+                fat_dir_next(&sort_iter, &sort_entry) <= 0 ||
+                sort_entry.index != sort_arena[i].index) {
+                printf("  Entry %u could not be re-read\n", sort_arena[i].index);
+                continue;
+            }
+
+            fat_dir_print_entry(&sort_entry);
+            files++;
+            if (!(sort_entry.attributes & FAT_ATTR_DIRECTORY)) {
+                bytes += sort_entry.size;
+            }
+        }
+
+        if (count > 0) {
+            last = sort_arena[count - 1];
+        }
+    } while (more);
+
+    printf("  total %d\n", (int)(bytes / 1024));
+    printf("  %u files and directories", files);
+    if (passes > 1) {
+        printf(" (sorted in %u passes)", passes);
+    }
+    printf("\n");
+
+    return result < 0 ? result : 0;
+}
@@ -0,0 +1,34 @@
+#ifndef FAT_SORT_H
+#define FAT_SORT_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+
+// Records sorted in RAM at once (32 bytes each). Larger directories are
+// emitted in several passes, each selecting the next arena-full in order.
+#ifndef FAT_SORT_ARENA_RECORDS
+#define FAT_SORT_ARENA_RECORDS 512
+#endif
+
+// Bytes of the (upper-cased) name kept for ordering by name. Names that
+// agree on all of them are told apart by re-reading both full names.
+#define FAT_SORT_NAME_KEY 20
+
+// Sort orders, as in ls: by name, largest first (-S), newest first (-t)
+#define FAT_SORT_NAME    0
+#define FAT_SORT_SIZE    1
+#define FAT_SORT_TIME    2
+#define FAT_SORT_REVERSE 0x80       // Or-ed in to reverse the order (-r)
+
+// Compact stand-in for one entry; the entry itself is re-read to print it
+typedef struct {
+    uint32_t key;                   // Size or packed date and time
+    uint32_t set_index;             // Where the entry starts in its directory
+    uint32_t index;                 // Its 8.3 entry, to confirm the re-read
+    char name[FAT_SORT_NAME_KEY];
+} fat_sort_record_t;
+
+// List one directory in the given order, within the arena's memory
+int fat_sort_list(fat_volume_t* vol, const char* path, int order);
+
+#endif // FAT_SORT_H
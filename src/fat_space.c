@@ -0,0 +1,319 @@
+#include "fat_space.h"
+#include "fat12.h"
+#include "partition_display.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <string.h>
+
+// Word-aligned chunk buffer for streaming the FAT
+static uint32_t space_buf[FAT_SPACE_CHUNK_SECTORS * 512 / 4];
+
+// Words examined together before falling back to per-word run tracking
+#define FAT_SPACE_GROUP_WORDS 8
+
+// SWAR layout of one 32-bit word: FAT32 holds one entry, FAT16 two.
+// nz_mask() sets the top bit of every lane whose entry is non-zero.
+typedef struct {
+    uint32_t lanes;
+    uint32_t lane_bits;
+    uint32_t flag_shift;        // Bit of the lane-0 flag
+    uint32_t all_used;          // Mask with every lane flag set
+    uint32_t bad_pattern;       // Bad-cluster marker replicated per lane
+} fat_space_layout_t;
+
+static const fat_space_layout_t layout_fat32 = {1, 32, 28, 0x10000000, 0x0FFFFFF7};
+static const fat_space_layout_t layout_fat16 = {2, 16, 15, 0x80008000, 0xFFF7FFF7};
+
+// FAT12 entries are decoded into FAT16 lanes and share its scanner
+static const fat_space_layout_t layout_fat12 = {2, 16, 15, 0x80008000, 0x0FF70FF7};
+
+static inline uint32_t nz_mask_fat32(uint32_t w) {
+    // Entries are 28 bits: adding 0x0FFFFFFF carries into bit 28 iff non-zero
+    return ((w & 0x0FFFFFFF) + 0x0FFFFFFF) & 0x10000000;
+}
+
+static inline uint32_t nz_mask_fat16(uint32_t w) {
+    // Low 15 bits carry into bit 15; OR-ing w catches lanes with only bit 15 set
+    return (((w & 0x7FFF7FFF) + 0x7FFF7FFF) | w) & 0x80008000;
+}
+
+typedef struct {
+    uint32_t used;
+    uint32_t bad;
+    uint32_t next;              // Entry index of the next lane
+    uint32_t run;
+    uint32_t run_start;
+    uint32_t best;
+    uint32_t best_start;
+} fat_space_scan_t;
+
+static inline void scan_free(fat_space_scan_t* s, uint32_t count) {
+    if (s->run == 0) s->run_start = s->next;
+    s->run += count;
+}
+
+static inline void scan_close_run(fat_space_scan_t* s) {
+    if (s->run > s->best) {
+        s->best = s->run;
+        s->best_start = s->run_start;
+    }
+    s->run = 0;
+}
+
+// Run tracking for one word whose lanes are a mix of free and used
+static void scan_mixed_word(fat_space_scan_t* s, const fat_space_layout_t* l, uint32_t nz) {
+    for (uint32_t lane = 0; lane < l->lanes; lane++) {
+        if ((nz >> (l->flag_shift + lane * l->lane_bits)) & 1) {
+            scan_close_run(s);
+        } else {
+            scan_free(s, 1);
+        }
+        s->next++;
+    }
+}
+
+static void scan_words(fat_space_scan_t* s, const fat_space_layout_t* l,
+                       const uint32_t* words, uint32_t count) {
+    bool fat32 = (l->lanes == 1);
+    uint32_t used_acc = 0;
+    uint32_t bad_acc = 0;
+    uint32_t i = 0;
+
+    while (i < count) {
+        uint32_t n = count - i;
+        if (n > FAT_SPACE_GROUP_WORDS) n = FAT_SPACE_GROUP_WORDS;
+
+        uint32_t nz[FAT_SPACE_GROUP_WORDS];
+        uint32_t any_used = 0;
+        uint32_t all_used = l->all_used;
+
+        // Branch-free counting: lane flags are summed in place, so FAT16
+        // keeps two 16-bit counters in one accumulator
+        for (uint32_t j = 0; j < n; j++) {
+            uint32_t w = words[i + j];
+            uint32_t bad_nz;
+            if (fat32) {
+                nz[j] = nz_mask_fat32(w);
+                bad_nz = nz_mask_fat32(w ^ l->bad_pattern);
+            } else {
+                nz[j] = nz_mask_fat16(w);
+                bad_nz = nz_mask_fat16(w ^ l->bad_pattern);
+            }
+            used_acc += nz[j] >> l->flag_shift;
+            bad_acc += (~bad_nz & l->all_used) >> l->flag_shift;
+            any_used |= nz[j];
+            all_used &= nz[j];
+        }
+
+        // Largest-run tracking only inspects words in mixed groups
+        if (any_used == 0) {
+            scan_free(s, n * l->lanes);
+            s->next += n * l->lanes;
+        } else if (all_used == l->all_used) {
+            scan_close_run(s);
+            s->next += n * l->lanes;
+        } else {
+            for (uint32_t j = 0; j < n; j++) {
+                if (nz[j] == 0) {
+                    scan_free(s, l->lanes);
+                    s->next += l->lanes;
+                } else if (nz[j] == l->all_used) {
+                    scan_close_run(s);
+                    s->next += l->lanes;
+                } else {
+                    scan_mixed_word(s, l, nz[j]);
+                }
+            }
+        }
+
+        i += n;
+    }
+
+    // Chunks are at most 2048 words, so 16-bit lane counters cannot overflow
+    s->used += (used_acc & 0xFFFF) + (used_acc >> 16);
+    s->bad += (bad_acc & 0xFFFF) + (bad_acc >> 16);
+}
+
+// Entry left alone in the low lane of a word at the end of the FAT
+static void scan_last_entry(fat_space_scan_t* s, uint32_t value, uint32_t bad_value) {
+    if (value != 0) {
+        scan_close_run(s);
+        s->used++;
+        if (value == bad_value) s->bad++;
+    } else {
+        scan_free(s, 1);
+    }
+    s->next++;
+}
+
+static int scan_fat12_entries(uint32_t* words, uint32_t first_entry, uint32_t entries, void* ctx) {
+    fat_space_scan_t* scan = (fat_space_scan_t*)ctx;
+
+    // Entries 0 and 1 are reserved: present them as used, not bad
+    if (first_entry == 0) {
+        words[0] = 0x0FFF0FFF;
+    }
+
+    scan_words(scan, &layout_fat12, words, entries / 2);
+    if (entries & 1) {
+        scan_last_entry(scan, words[entries / 2] & 0xFFF, 0xFF7);
+    }
+    return 0;
+}
+
+// Totals shared by every FAT width once the scan has seen all entries
+static void fat_space_finish(fat_volume_t* vol, fat_space_t* space, fat_space_scan_t* scan, uint64_t start_us) {
+    scan_close_run(scan);
+
+    // The two reserved entries were counted as used
+    uint32_t cluster_bytes = fat_volume_cluster_bytes(vol);
+    uint32_t used_clusters = scan->used - 2 - scan->bad;
+    space->total_clusters = vol->cluster_count;
+    space->cluster_bytes = cluster_bytes;
+    space->free_clusters = vol->cluster_count + 2 - scan->used;
+    space->bad_clusters = scan->bad;
+    space->largest_free_run = scan->best;
+    space->largest_free_start = scan->best_start;
+    space->used_bytes = (uint64_t)used_clusters * cluster_bytes;
+    space->free_bytes = (uint64_t)space->free_clusters * cluster_bytes;
+    space->scan_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+}
+
+int fat_space_count(fat_volume_t* vol, fat_space_t* space) {
+    memset(space, 0, sizeof(*space));
+
+    if (vol->fat_type == 12) {
+        fat_space_scan_t scan = {0};
+        uint64_t start_us = time_us_64();
+
+        int result = fat12_stream(vol, scan_fat12_entries, &scan);
+        if (result != 0) {
+            return result;
+        }
+
+        fat_space_finish(vol, space, &scan, start_us);
+        return 0;
+    }
+
+    const fat_space_layout_t* layout = (vol->fat_type == 32) ? &layout_fat32 : &layout_fat16;
+    uint32_t entry_count = vol->cluster_count + 2;
+    uint32_t word_count = entry_count / layout->lanes;
+    uint32_t words_per_sector = 512 / 4;
+    uint32_t fat_sectors = vol->fat_entry_sectors;
+
+    fat_space_scan_t scan = {0};
+    uint32_t words_done = 0;
+    uint32_t chunk_start = 0;
+    uint64_t start_us = time_us_64();
+
+    for (uint32_t sector = 0; sector < fat_sectors; sector += FAT_SPACE_CHUNK_SECTORS) {
+        uint32_t chunk = fat_sectors - sector;
+        if (chunk > FAT_SPACE_CHUNK_SECTORS) chunk = FAT_SPACE_CHUNK_SECTORS;
+
+        if (sd_read_blocks(vol->fat_lba + sector, chunk, (uint8_t*)space_buf) != 0) {
+            return -1;
+        }
+        chunk_start = sector;
+
+        // Entries 0 and 1 are reserved: present them as used, not bad
+        if (sector == 0) {
+            if (layout->lanes == 1) {
+                space_buf[0] = 0x0FFFFFFF;
+                space_buf[1] = 0x0FFFFFFF;
+            } else {
+                space_buf[0] = 0xFFFFFFFF;
+            }
+        }
+
+        uint32_t words = chunk * words_per_sector;
+        if (words > word_count - words_done) words = word_count - words_done;
+
+        scan_words(&scan, layout, space_buf, words);
+        words_done += words;
+    }
+
+    // Odd FAT16 entry count leaves one lane outside the last whole word
+    if (scan.next < entry_count) {
+        uint16_t last = ((const uint16_t*)space_buf)[scan.next - chunk_start * 256];
+        scan_last_entry(&scan, last, 0xFFF7);
+    }
+
+    fat_space_finish(vol, space, &scan, start_us);
+    return 0;
+}
+
+void fat_space_print(const fat_space_t* space) {
+    char used_str[32];
+    char free_str[32];
+    char run_str[32];
+
+    partition_display_format_size(space->used_bytes, used_str, sizeof(used_str));
+    partition_display_format_size(space->free_bytes, free_str, sizeof(free_str));
+    partition_display_format_size((uint64_t)space->largest_free_run * space->cluster_bytes, run_str, sizeof(run_str));
+
+    printf("\n  === Free space ===\n");
+    printf("  Clusters: %u total, %u free (%.1f%%), %u bad\n",
+           space->total_clusters, space->free_clusters,
+           space->total_clusters ? space->free_clusters * 100.0 / space->total_clusters : 0.0,
+           space->bad_clusters);
+    printf("  Used: %s, Free: %s\n", used_str, free_str);
+    printf("  Largest free run: %u clusters (%s) at cluster %u\n",
+           space->largest_free_run, run_str, space->largest_free_start);
+    printf("  FAT scanned in %u ms\n", space->scan_ms);
+}
+
+void fat_space_print_fsinfo(const fat_volume_t* vol, const fat_fsinfo_t* info) {
+    printf("\n  === Free space (FSInfo) ===\n");
+
+    if (info->free_count == FAT_FSINFO_UNKNOWN || info->free_count > vol->cluster_count) {
+        printf("  Free clusters: unknown\n");
+    } else {
+        char used_str[32];
+        char free_str[32];
+        uint32_t cluster_bytes = fat_volume_cluster_bytes(vol);
+        uint64_t free_bytes = (uint64_t)info->free_count * cluster_bytes;
+        uint64_t used_bytes = (uint64_t)(vol->cluster_count - info->free_count) * cluster_bytes;
+
+        partition_display_format_size(used_bytes, used_str, sizeof(used_str));
+        partition_display_format_size(free_bytes, free_str, sizeof(free_str));
+
+        printf("  Clusters: %u total, %u free (%.1f%%)\n",
+               vol->cluster_count, info->free_count,
+               info->free_count * 100.0 / vol->cluster_count);
+        printf("  Used: %s, Free: %s\n", used_str, free_str);
+    }
+
+    if (info->next_free == FAT_FSINFO_UNKNOWN) {
+        printf("  Next free hint: none\n");
+    } else {
+        printf("  Next free hint: cluster %u\n", info->next_free);
+    }
+}
+
+int fat_space_verify_fsinfo(fat_volume_t* vol, const fat_fsinfo_t* info, const fat_space_t* space) {
+    int mismatches = 0;
+
+    if (info->free_count != FAT_FSINFO_UNKNOWN && info->free_count != space->free_clusters) {
+        printf("  MISMATCH: FSInfo free count %u, FAT has %u free clusters\n",
+               info->free_count, space->free_clusters);
+        mismatches++;
+    }
+
+    // The hint only needs to be a sensible place to start searching
+    if (info->next_free != FAT_FSINFO_UNKNOWN) {
+        uint32_t value;
+        if (!fat_volume_is_data_cluster(vol, info->next_free)) {
+            printf("  MISMATCH: next free hint %u is outside the data area\n", info->next_free);
+            mismatches++;
+        } else if (fat_volume_get_entry(vol, info->next_free, &value) == 0 && value != 0 &&
+                   space->free_clusters > 0) {
+            printf("  Note: next free hint %u points at an allocated cluster\n", info->next_free);
+        }
+    }
+
+    if (mismatches == 0) {
+        printf("  FSInfo verified against the FAT\n");
+    }
+
+    return mismatches;
+}
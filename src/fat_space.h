@@ -0,0 +1,30 @@
+#ifndef FAT_SPACE_H
+#define FAT_SPACE_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+
+// FAT sectors fetched per multi-block read while streaming the table (8 KB)
+#define FAT_SPACE_CHUNK_SECTORS 16
+
+// Capacity usage of one FAT volume, counted from the FAT itself
+typedef struct {
+    uint32_t total_clusters;
+    uint32_t cluster_bytes;
+    uint32_t free_clusters;
+    uint32_t bad_clusters;
+    uint32_t largest_free_run;      // In clusters
+    uint32_t largest_free_start;    // First cluster of that run
+    uint64_t used_bytes;
+    uint64_t free_bytes;
+    uint32_t scan_ms;
+} fat_space_t;
+
+int fat_space_count(fat_volume_t* vol, fat_space_t* space);
+void fat_space_print(const fat_space_t* space);
+
+// FAT32 FSInfo triage numbers and their verification against a full count
+void fat_space_print_fsinfo(const fat_volume_t* vol, const fat_fsinfo_t* info);
+int fat_space_verify_fsinfo(fat_volume_t* vol, const fat_fsinfo_t* info, const fat_space_t* space);
+
+#endif // FAT_SPACE_H
@@ -0,0 +1,132 @@
+#include "fat_undelete.h"
+#include "fat_walk.h"
+#include "partition_display.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char* const status_names[FAT_UNDELETE_STATUSES] = {
+    "empty", "good", "partial", "overwritten", "invalid", "unknown"
+};
+
+int fat_undelete_assess(fat_volume_t* vol, const fat_dirent_t* ent, uint32_t* free_clusters,
+                        uint32_t* span) {
+    uint32_t cluster_bytes = fat_volume_cluster_bytes(vol);
+    uint32_t first = ent->first_cluster;
+
+    *free_clusters = 0;
+    *span = (ent->attributes & FAT_ATTR_DIRECTORY) ? 1 :
+            (uint32_t)(((uint64_t)ent->size + cluster_bytes - 1) / cluster_bytes);
+
+    // A file of size 0 has nothing to recover, whatever cluster it names;
+    // anything else without a first cluster cannot be located
+    if (*span == 0) {
+        return FAT_UNDELETE_EMPTY;
+    }
+    if (first == 0) {
+        return FAT_UNDELETE_UNKNOWN;
+    }
+
+    if (!fat_volume_is_data_cluster(vol, first)) {
+        return FAT_UNDELETE_INVALID;
+    }
+
+    // A span running off the end of the volume cannot be fully free
+    for (uint32_t i = 0; i < *span; i++) {
+        uint32_t value;
+        if (!fat_volume_is_data_cluster(vol, first + i) ||
+            fat_volume_get_entry(vol, first + i, &value) != 0) {
+            break;
+        }
+        if (value == 0) {
+            (*free_clusters)++;
+        } else if (i == 0) {
+            return FAT_UNDELETE_OVERWRITTEN;
+        }
+    }
+
+    return (*free_clusters == *span) ? FAT_UNDELETE_GOOD : FAT_UNDELETE_PARTIAL;
+}
+
+typedef struct {
+    fat_volume_t* vol;
+    fat_undelete_report_t* report;
+    bool header;                    // "Deleted entries in" printed for this directory
+} fat_undelete_ctx_t;
+
+static void fat_undelete_enter(const char* path, uint32_t first_cluster, uint32_t depth, void* ctx) {
+    (void)path;
+    (void)first_cluster;
+    (void)depth;
+    fat_undelete_ctx_t* undelete = ctx;
+    undelete->report->dirs_scanned++;
+    undelete->header = false;
+}
+
+static void fat_undelete_entry(const char* path, const fat_dirent_t* ent, void* ctx) {
+    fat_undelete_ctx_t* undelete = ctx;
+    fat_undelete_report_t* report = undelete->report;
+
+    if (!ent->deleted) {
+        return;
+    }
+
+    uint32_t free_clusters, span;
+    int status = fat_undelete_assess(undelete->vol, ent, &free_clusters, &span);
+
+    report->deleted_entries++;
+    report->by_status[status]++;
+    if (status == FAT_UNDELETE_GOOD) {
+        report->recoverable_bytes += ent->size;
+    }
+
+    if (!undelete->header) {
+        printf("\n  Deleted entries in %s:\n", path);
+        undelete->header = true;
+    }
+
+    printf("  %-11s %3u/%-3u %c %10u  cl %-8u %s",
+           status_names[status], free_clusters, span,
+           (ent->attributes & FAT_ATTR_DIRECTORY) ? 'd' : '-',
+           ent->size, ent->first_cluster, ent->name);
+    if (strcmp(ent->name, ent->short_name) != 0) {
+        printf(" [%s]", ent->short_name);
+    }
+    printf("\n");
+}
+
+int fat_undelete_scan(fat_volume_t* vol, fat_undelete_report_t* report) {
+    fat_undelete_ctx_t ctx = {vol, report, false};
+    const fat_walk_visitor_t visitor = {
+        .enter_dir = fat_undelete_enter,
+        .entry = fat_undelete_entry,
+        .dir_done = NULL,
+        .leave_dir = NULL,
+        .include_deleted = true,
+    };
+
+    memset(report, 0, sizeof(*report));
+    printf("\n  === Deleted file scan ===\n");
+    printf("  %-11s %7s %c %10s  %-11s %s\n", "status", "free", ' ', "size", "cluster", "name");
+
+    report->error = fat_walk(vol, &visitor, &ctx);
+    return report->error;
+}
+
+void fat_undelete_print(const fat_undelete_report_t* report) {
+    char size_str[32];
+
+    printf("\n  %u deleted entries in %u directories\n",
+           report->deleted_entries, report->dirs_scanned);
+    for (int i = 0; i < FAT_UNDELETE_STATUSES; i++) {
+        if (report->by_status[i] > 0) {
+            printf("    %-11s %u\n", status_names[i], report->by_status[i]);
+        }
+    }
+
+    partition_display_format_size(report->recoverable_bytes, size_str, sizeof(size_str));
+    printf("  Likely recoverable: %s\n", size_str);
+
+    if (report->error < 0) {
+        printf("  Some directories could not be read completely (error %d)\n", report->error);
+    }
+}
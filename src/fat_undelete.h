@@ -0,0 +1,34 @@
+#ifndef FAT_UNDELETE_H
+#define FAT_UNDELETE_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+#include "fat_dir.h"
+
+// Recoverability of a deleted entry, judged from the FAT. Deleting a file
+// zeroes its chain, so the data is assumed to have been contiguous.
+#define FAT_UNDELETE_EMPTY       0  // Size 0, nothing to recover
+#define FAT_UNDELETE_GOOD        1  // Every cluster it would span is still free
+#define FAT_UNDELETE_PARTIAL     2  // First cluster free, later ones reused
+#define FAT_UNDELETE_OVERWRITTEN 3  // First cluster allocated again
+#define FAT_UNDELETE_INVALID     4  // First cluster outside the data area
+#define FAT_UNDELETE_UNKNOWN     5  // Has data but no first cluster recorded
+#define FAT_UNDELETE_STATUSES    6
+
+typedef struct {
+    uint32_t dirs_scanned;
+    uint32_t deleted_entries;
+    uint32_t by_status[FAT_UNDELETE_STATUSES];
+    uint64_t recoverable_bytes;     // Total size of entries rated good
+    int error;                      // First walk error, 0 if every directory was read
+} fat_undelete_report_t;
+
+int fat_undelete_assess(fat_volume_t* vol, const fat_dirent_t* ent, uint32_t* free_clusters,
+                        uint32_t* span);
+
+// Walk the tree once, including deleted directories that can still be
+// read, and print the deleted entries found in each directory.
+int fat_undelete_scan(fat_volume_t* vol, fat_undelete_report_t* report);
+void fat_undelete_print(const fat_undelete_report_t* report);
+
+#endif // FAT_UNDELETE_H
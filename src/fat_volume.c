@@ -0,0 +1,285 @@
+#include "fat_volume.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <string.h>
+
+static uint16_t read_le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int fat_volume_mount(fat_volume_t* vol, uint32_t start_lba) {
+    uint8_t boot_sector[512];
+
+    memset(vol, 0, sizeof(*vol));
+
+    if (sd_read_block(start_lba, boot_sector) != 0) {
+        return -1;
+    }
+
+    if (boot_sector[510] != 0x55 || boot_sector[511] != 0xAA) {
+        return -2; // Invalid boot signature
+    }
+
+    vol->start_lba = start_lba;
+    vol->bytes_per_sector = read_le16(&boot_sector[11]);
+    vol->sectors_per_cluster = boot_sector[13];
+    vol->reserved_sectors = read_le16(&boot_sector[14]);
+    vol->num_fats = boot_sector[16];
+    vol->root_entries = read_le16(&boot_sector[17]);
+    vol->total_sectors = read_le16(&boot_sector[19]);
+    vol->sectors_per_fat = read_le16(&boot_sector[22]);
+
+    if (vol->total_sectors == 0) {
+        vol->total_sectors = read_le32(&boot_sector[32]);
+    }
+
+    // For FAT32, sectors per FAT is at offset 36
+    bool fat32_bpb = (vol->sectors_per_fat == 0);
+    if (fat32_bpb) {
+        vol->sectors_per_fat = read_le32(&boot_sector[36]);
+        vol->root_cluster = read_le32(&boot_sector[44]);
+        vol->fsinfo_sector = read_le16(&boot_sector[48]);
+    }
+
+    // The SD driver only transfers 512-byte blocks
+    if (vol->bytes_per_sector != 512 || vol->sectors_per_cluster == 0 ||
+        vol->num_fats == 0 || vol->sectors_per_fat == 0) {
+        return -3; // Unsupported or corrupt BPB
+    }
+
+    vol->fat_lba = start_lba + vol->reserved_sectors;
+    vol->root_dir_lba = vol->fat_lba + vol->num_fats * vol->sectors_per_fat;
+    vol->root_dir_sectors = (vol->root_entries * 32 + 511) / 512;
+    vol->first_data_lba = vol->root_dir_lba + vol->root_dir_sectors;
+
+    uint32_t meta_sectors = vol->first_data_lba - start_lba;
+    if (vol->total_sectors <= meta_sectors) {
+        return -3;
+    }
+    vol->cluster_count = (vol->total_sectors - meta_sectors) / vol->sectors_per_cluster;
+
+    // FAT type is defined by the cluster count, not the BPB label
+    if (vol->cluster_count < 4085) {
+        vol->fat_type = 12;
+    } else if (vol->cluster_count < 65525) {
+        vol->fat_type = 16;
+    } else {
+        vol->fat_type = 32;
+    }
+
+    if ((vol->fat_type == 32) != fat32_bpb) {
+        return -3;
+    }
+
+    // Every cluster needs a FAT entry; passes that stream the FAT read
+    // exactly fat_entry_sectors and rely on this check
+    uint64_t fat_bytes = (((uint64_t)vol->cluster_count + 2) * vol->fat_type + 7) / 8;
+    vol->fat_entry_sectors = (uint32_t)((fat_bytes + 511) / 512);
+    if (vol->fat_entry_sectors > vol->sectors_per_fat) {
+        return -3;
+    }
+
+    return 0;
+}
+
+uint32_t fat_volume_cluster_to_lba(const fat_volume_t* vol, uint32_t cluster) {
+    return vol->first_data_lba + (cluster - 2) * vol->sectors_per_cluster;
+}
+
+uint32_t fat_volume_cluster_bytes(const fat_volume_t* vol) {
+    return (uint32_t)vol->sectors_per_cluster * 512;
+}
+
+bool fat_volume_is_data_cluster(const fat_volume_t* vol, uint32_t cluster) {
+    return cluster >= 2 && cluster < vol->cluster_count + 2;
+}
+
+bool fat_volume_is_end_of_chain(const fat_volume_t* vol, uint32_t value) {
+    switch (vol->fat_type) {
+        case 12: return value >= 0xFF8;
+        case 16: return value >= 0xFFF8;
+        default: return value >= 0x0FFFFFF8;
+    }
+}
+
+bool fat_volume_is_bad_cluster(const fat_volume_t* vol, uint32_t value) {
+    switch (vol->fat_type) {
+        case 12: return value == 0xFF7;
+        case 16: return value == 0xFFF7;
+        default: return value == 0x0FFFFFF7;
+    }
+}
+
+int fat_volume_read_fsinfo(const fat_volume_t* vol, fat_fsinfo_t* info) {
+    uint8_t sector[512];
+
+    if (vol->fat_type != 32 || vol->fsinfo_sector == 0 || vol->fsinfo_sector == 0xFFFF) {
+        return -3; // No FSInfo on this volume
+    }
+
+    if (sd_read_block(vol->start_lba + vol->fsinfo_sector, sector) != 0) {
+        return -1;
+    }
+
+    // Lead, structure and trail signatures
+    if (read_le32(&sector[0]) != 0x41615252 ||
+        read_le32(&sector[484]) != 0x61417272 ||
+        read_le32(&sector[508]) != 0xAA550000) {
+        return -2;
+    }
+
+    info->free_count = read_le32(&sector[488]);
+    info->next_free = read_le32(&sector[492]);
+    return 0;
+}
+
+const uint8_t* fat_cache_get(fat_cache_t* cache, uint32_t fat_lba, uint32_t fat_sectors, uint32_t fat_sector) {
+    if (cache->sector_count > 0 &&
+        fat_sector >= cache->first_sector &&
+        fat_sector < cache->first_sector + cache->sector_count) {
+        cache->hits++;
+        return &cache->data[(fat_sector - cache->first_sector) * 512];
+    }
+
+    if (fat_sector >= fat_sectors) {
+        return NULL;
+    }
+
+    // Sequential prefetch: load the window forward from the missing sector
+    uint32_t count = fat_sectors - fat_sector;
+    if (count > FAT_CACHE_WINDOW_SECTORS) {
+        count = FAT_CACHE_WINDOW_SECTORS;
+    }
+
+    cache->misses++;
+    cache->sector_count = 0;
+    if (sd_read_blocks(fat_lba + fat_sector, count, cache->data) != 0) {
+        return NULL;
+    }
+
+    cache->first_sector = fat_sector;
+    cache->sector_count = count;
+    return cache->data;
+}
+
+// Make FAT-relative sector resident and return a pointer to it
+static const uint8_t* fat_cache_get_sector(fat_volume_t* vol, uint32_t fat_sector) {
+    return fat_cache_get(&vol->fat_cache, vol->fat_lba, vol->sectors_per_fat, fat_sector);
+}
+
+int fat_volume_get_entry(fat_volume_t* vol, uint32_t cluster, uint32_t* value) {
+    if (cluster >= vol->cluster_count + 2) {
+        return -2; // Outside the FAT
+    }
+
+    if (vol->fat_type == 12) {
+        // 1.5 bytes per entry; the pair holding it can straddle two sectors
+        uint32_t offset = cluster + cluster / 2;
+        const uint8_t* sector = fat_cache_get_sector(vol, offset / 512);
+        if (!sector) {
+            return -1;
+        }
+
+        uint32_t pair = sector[offset % 512];
+        if (offset % 512 == 511) {
+            sector = fat_cache_get_sector(vol, offset / 512 + 1);
+            if (!sector) {
+                return -1;
+            }
+            pair |= sector[0] << 8;
+        } else {
+            pair |= sector[offset % 512 + 1] << 8;
+        }
+
+        *value = (cluster & 1) ? (pair >> 4) : (pair & 0xFFF);
+        return 0;
+    }
+
+    uint32_t entry_size = (vol->fat_type == 32) ? 4 : 2;
+    uint32_t offset = cluster * entry_size;
+
+    const uint8_t* sector = fat_cache_get_sector(vol, offset / 512);
+    if (!sector) {
+        return -1;
+    }
+
+    const uint8_t* entry = sector + (offset % 512);
+    if (vol->fat_type == 32) {
+        *value = read_le32(entry) & 0x0FFFFFFF;
+    } else {
+        *value = read_le16(entry);
+    }
+
+    return 0;
+}
+
+int fat_volume_next_cluster(fat_volume_t* vol, uint32_t cluster, uint32_t* next) {
+    uint32_t value;
+    int result = fat_volume_get_entry(vol, cluster, &value);
+    if (result != 0) {
+        return result;
+    }
+
+    if (fat_volume_is_end_of_chain(vol, value)) {
+        return 0;
+    }
+
+    if (!fat_volume_is_data_cluster(vol, value)) {
+        return -4; // Free, bad or out-of-range link inside a chain
+    }
+
+    *next = value;
+    return 1;
+}
+
+// Collapse the chain starting at *cluster into one extent. On return
+// *cluster is the start of the following extent, or 0 at end of chain.
+// Returns 1 when an extent was produced, 0 when *cluster was 0. Callers
+// must bound the total cluster count themselves to survive looping chains.
+int fat_volume_next_extent(fat_volume_t* vol, uint32_t* cluster, fat_extent_t* extent) {
+    uint32_t current = *cluster;
+
+    if (current == 0) {
+        return 0;
+    }
+
+    if (!fat_volume_is_data_cluster(vol, current)) {
+        return -4;
+    }
+
+    extent->first_cluster = current;
+    extent->cluster_count = 1;
+
+    for (;;) {
+        uint32_t next;
+        int result = fat_volume_next_cluster(vol, current, &next);
+        if (result < 0) {
+            return result;
+        }
+
+        if (result == 0) {
+            *cluster = 0;
+            return 1;
+        }
+
+        if (next != current + 1) {
+            *cluster = next;
+            return 1;
+        }
+
+        current = next;
+        extent->cluster_count++;
+    }
+}
+
+void fat_volume_print_cache_stats(const fat_volume_t* vol) {
+    uint32_t lookups = vol->fat_cache.hits + vol->fat_cache.misses;
+
+    printf("FAT cache: %u lookups, %u hits, %u window loads (%u sectors each)\n",
+           lookups, vol->fat_cache.hits, vol->fat_cache.misses,
+           FAT_CACHE_WINDOW_SECTORS);
+}
@@ -0,0 +1,75 @@
+#ifndef FAT_VOLUME_H
+#define FAT_VOLUME_H
+
+#include "pico/stdlib.h"
+
+// Number of consecutive FAT sectors kept in RAM per volume (4 KB)
+#define FAT_CACHE_WINDOW_SECTORS 8
+
+// Window of consecutive FAT sectors, separate from any data caching.
+// A miss reloads the window starting at the missing sector, so walking a
+// chain forward prefetches the FAT entries that follow it.
+typedef struct {
+    uint32_t first_sector;      // FAT-relative sector held in data[0]
+    uint32_t sector_count;      // Valid sectors in the window (0 = empty)
+    uint32_t hits;
+    uint32_t misses;
+    uint8_t data[FAT_CACHE_WINDOW_SECTORS * 512];
+} fat_cache_t;
+
+// Return a pointer to FAT-relative sector fat_sector of the FAT at fat_lba,
+// loading the window when it is not resident; NULL on error
+const uint8_t* fat_cache_get(fat_cache_t* cache, uint32_t fat_lba, uint32_t fat_sectors, uint32_t fat_sector);
+
+// Geometry of a mounted FAT12/16/32 volume
+typedef struct {
+    uint32_t start_lba;
+    uint8_t fat_type;           // 12, 16 or 32
+    uint8_t sectors_per_cluster;
+    uint8_t num_fats;
+    uint16_t bytes_per_sector;
+    uint16_t reserved_sectors;
+    uint16_t root_entries;
+    uint16_t fsinfo_sector;     // FAT32 only, relative to start_lba
+    uint32_t sectors_per_fat;
+    uint32_t fat_entry_sectors; // Sectors of each FAT holding entries 0..cluster_count+1
+    uint32_t total_sectors;
+    uint32_t fat_lba;           // First sector of FAT #1
+    uint32_t root_dir_lba;      // Fixed root directory (FAT12/16)
+    uint32_t root_dir_sectors;
+    uint32_t first_data_lba;    // LBA of cluster 2
+    uint32_t cluster_count;     // Number of data clusters
+    uint32_t root_cluster;      // Root directory cluster (FAT32)
+    fat_cache_t fat_cache;
+} fat_volume_t;
+
+// FAT32 FSInfo sector contents
+typedef struct {
+    uint32_t free_count;        // 0xFFFFFFFF = unknown
+    uint32_t next_free;         // 0xFFFFFFFF = no hint
+} fat_fsinfo_t;
+
+#define FAT_FSINFO_UNKNOWN 0xFFFFFFFF
+
+// Run of physically contiguous clusters within a chain
+typedef struct {
+    uint32_t first_cluster;
+    uint32_t cluster_count;
+} fat_extent_t;
+
+// Volume setup and geometry
+int fat_volume_mount(fat_volume_t* vol, uint32_t start_lba);
+uint32_t fat_volume_cluster_to_lba(const fat_volume_t* vol, uint32_t cluster);
+uint32_t fat_volume_cluster_bytes(const fat_volume_t* vol);
+bool fat_volume_is_data_cluster(const fat_volume_t* vol, uint32_t cluster);
+bool fat_volume_is_end_of_chain(const fat_volume_t* vol, uint32_t value);
+bool fat_volume_is_bad_cluster(const fat_volume_t* vol, uint32_t value);
+int fat_volume_read_fsinfo(const fat_volume_t* vol, fat_fsinfo_t* info);
+
+// FAT table access through the per-volume window
+int fat_volume_get_entry(fat_volume_t* vol, uint32_t cluster, uint32_t* value);
+int fat_volume_next_cluster(fat_volume_t* vol, uint32_t cluster, uint32_t* next);
+int fat_volume_next_extent(fat_volume_t* vol, uint32_t* cluster, fat_extent_t* extent);
+void fat_volume_print_cache_stats(const fat_volume_t* vol);
+
+#endif // FAT_VOLUME_H
@@ -0,0 +1,261 @@
+#include "fat_walk.h"
+#include "sd_block.h"
+#include <stdio.h>
+#include <string.h>
+
+// Walk state is static: only the top frame's directory is ever open, so a
+// single iterator and path buffer serve the whole stack.
+static fat_walk_frame_t walk_stack[FAT_WALK_MAX_DEPTH];
+static fat_dir_iter_t walk_iter;
+static fat_dirent_t walk_entry;
+static char walk_path[FAT_WALK_PATH_MAX];
+static uint8_t walk_sector[512];
+static const fat_walk_visitor_t* walk_visitor;
+static void* walk_ctx;
+
+// Clusters map to ascending LBAs, so sorting by cluster keeps I/O sequential
+static void fat_walk_sort_children(fat_walk_frame_t* f) {
+    for (int i = 1; i < f->child_count; i++) {
+        fat_walk_child_t child = f->children[i];
+        int j = i - 1;
+        while (j >= 0 && f->children[j].cluster > child.cluster) {
+            f->children[j + 1] = f->children[j];
+            j--;
+        }
+        f->children[j + 1] = child;
+    }
+}
+
+static bool fat_walk_filter(const uint8_t* entry, void* ctx) {
+    (void)ctx;
+    return (entry[11] & FAT_ATTR_DIRECTORY) || walk_visitor->filter(entry, walk_ctx);
+}
+
+// Scan a directory from entry index `from`, optionally reporting every entry,
+// and collect the next batch of subdirectories to descend into
+static int fat_walk_scan(fat_volume_t* vol, fat_walk_frame_t* f, uint32_t from, bool report,
+                         const fat_walk_visitor_t* visitor, void* ctx) {
+    int result;
+
+    f->child_count = 0;
+    f->next_child = 0;
+    f->scan_done = true;
+
+    fat_dir_open(&walk_iter, vol, f->first_cluster);
+    walk_iter.include_deleted = visitor->include_deleted;
+    walk_iter.first_cluster_only = f->deleted;
+    if (visitor->filter) {
+        walk_iter.filter = fat_walk_filter;
+    }
+    if (from > 0 && fat_dir_seek(&walk_iter, from) != 0) {
+        return walk_iter.error;
+    }
+
+    while ((result = fat_dir_next(&walk_iter, &walk_entry)) > 0) {
+        if (report && visitor->entry) {
+            visitor->entry(walk_path, &walk_entry, ctx);
+        }
+
+        if (!(walk_entry.attributes & FAT_ATTR_DIRECTORY)) {
+            continue;
+        }
+
+        if (f->child_count < FAT_WALK_BATCH) {
+            f->children[f->child_count].cluster = walk_entry.first_cluster;
+            f->children[f->child_count].set_index = walk_entry.set_index;
+            f->children[f->child_count].deleted = walk_entry.deleted || f->deleted;
+            f->child_count++;
+        } else if (f->scan_done) {
+            // Batch full: remember where to resume collecting
+            f->scan_done = false;
+            f->scan_index = walk_entry.set_index;
+            if (!report) break;
+        }
+    }
+
+    fat_walk_sort_children(f);
+    return result;
+}
+
+static int fat_walk_list(fat_volume_t* vol, fat_walk_frame_t* f, uint32_t depth,
+                         const fat_walk_visitor_t* visitor, void* ctx) {
+    if (visitor->enter_dir) visitor->enter_dir(walk_path, f->first_cluster, depth, ctx);
+    int result = fat_walk_scan(vol, f, 0, true, visitor, ctx);
+    if (visitor->dir_done) visitor->dir_done(walk_path, ctx);
+    return result;
+}
+
+// Reject links back into the current path (corrupt or looping directories)
+static bool fat_walk_is_ancestor(const fat_volume_t* vol, uint32_t depth, uint32_t cluster) {
+    if (cluster == 0 || (vol->fat_type == 32 && cluster == vol->root_cluster)) {
+        return true;
+    }
+
+    for (uint32_t d = 0; d < depth; d++) {
+        if (walk_stack[d].first_cluster == cluster) return true;
+    }
+
+    return false;
+}
+
+// A deleted directory is only worth reading if nothing has claimed its
+// first cluster since and the cluster still opens with its "." entry
+static bool fat_walk_is_deleted_dir(fat_volume_t* vol, uint32_t cluster) {
+    uint32_t value;
+
+    if (fat_volume_get_entry(vol, cluster, &value) != 0 || value != 0 ||
+        sd_read_block(fat_volume_cluster_to_lba(vol, cluster), walk_sector) != 0) {
+        return false;
+    }
+
+    uint32_t dot_cluster = (walk_sector[26] | (walk_sector[27] << 8)) |
+                           ((uint32_t)(walk_sector[20] | (walk_sector[21] << 8)) << 16);
+    return memcmp(walk_sector, ".          ", 11) == 0 &&
+           (walk_sector[11] & FAT_ATTR_DIRECTORY) && dot_cluster == cluster;
+}
+
+int fat_walk(fat_volume_t* vol, const fat_walk_visitor_t* visitor, void* ctx) {
+    int first_error = 0;
+    uint32_t depth = 1;
+
+    walk_visitor = visitor;
+    walk_ctx = ctx;
+    memset(&walk_stack[0], 0, sizeof(walk_stack[0]));
+    strcpy(walk_path, "/");
+    walk_stack[0].path_len = 1;
+
+    int result = fat_walk_list(vol, &walk_stack[0], 0, visitor, ctx);
+    if (result < 0) first_error = result;
+
+    while (depth > 0) {
+        fat_walk_frame_t* f = &walk_stack[depth - 1];
+
+        if (f->next_child < f->child_count) {
+            fat_walk_child_t child = f->children[f->next_child++];
+
+            if (fat_walk_is_ancestor(vol, depth, child.cluster) ||
+                !fat_volume_is_data_cluster(vol, child.cluster)) {
+                if (!child.deleted) {
+                    printf("  Skipping directory with invalid cluster %u under %s\n",
+                           child.cluster, walk_path);
+                }
+                continue;
+            }
+
+            // Most deleted directories have had their cluster reused
+            if (child.deleted && !fat_walk_is_deleted_dir(vol, child.cluster)) {
+                continue;
+            }
+
+            // Re-read the subdirectory's entry to recover its name
+            fat_dir_open(&walk_iter, vol, f->first_cluster);
+            walk_iter.include_deleted = visitor->include_deleted;
+            walk_iter.first_cluster_only = f->deleted;
+            if (fat_dir_seek(&walk_iter, child.set_index) != 0 ||
+                fat_dir_next(&walk_iter, &walk_entry) <= 0 ||
+                walk_entry.first_cluster != child.cluster) {
+                if (first_error == 0) first_error = -1;
+                continue;
+            }
+
+            size_t name_len = strlen(walk_entry.name);
+            size_t sep = (f->path_len > 1) ? 1 : 0;
+            if (depth >= FAT_WALK_MAX_DEPTH || f->path_len + sep + name_len >= FAT_WALK_PATH_MAX) {
+                printf("  Skipping %s%s%s: depth or path limit reached\n",
+                       walk_path, sep ? "/" : "", walk_entry.name);
+                continue;
+            }
+
+            if (sep) walk_path[f->path_len] = '/';
+            memcpy(&walk_path[f->path_len + sep], walk_entry.name, name_len + 1);
+
+            fat_walk_frame_t* next = &walk_stack[depth];
+            memset(next, 0, sizeof(*next));
+            next->first_cluster = child.cluster;
+            next->deleted = child.deleted;
+            next->path_len = (uint16_t)(f->path_len + sep + name_len);
+
+            result = fat_walk_list(vol, next, depth, visitor, ctx);
+            if (result < 0 && first_error == 0) first_error = result;
+            depth++;
+            continue;
+        }
+
+        if (!f->scan_done) {
+            result = fat_walk_scan(vol, f, f->scan_index, false, visitor, ctx);
+            if (result < 0 && first_error == 0) first_error = result;
+            continue;
+        }
+
+        if (visitor->leave_dir) visitor->leave_dir(walk_path, ctx);
+
+        depth--;
+        if (depth > 0) {
+            walk_path[walk_stack[depth - 1].path_len] = 0;
+        }
+    }
+
+    return first_error;
+}
+
+// 'ls -lR' visitor
+typedef struct {
+    uint32_t dirs;
+    uint32_t files;
+    uint64_t bytes;
+    int dir_count;
+    uint64_t dir_bytes;
+} fat_tree_stats_t;
+
+static void print_tree_enter(const char* path, uint32_t first_cluster, uint32_t depth, void* ctx) {
+    (void)first_cluster;
+    (void)depth;
+    fat_tree_stats_t* stats = ctx;
+    stats->dir_count = 0;
+    stats->dir_bytes = 0;
+    printf("\n  === Directory listing for %s ===\n", path);
+}
+
+static void print_tree_entry(const char* path, const fat_dirent_t* ent, void* ctx) {
+    (void)path;
+    fat_tree_stats_t* stats = ctx;
+
+    fat_dir_print_entry(ent);
+    stats->dir_count++;
+
+    if (ent->attributes & FAT_ATTR_DIRECTORY) {
+        stats->dirs++;
+    } else {
+        stats->files++;
+        stats->bytes += ent->size;
+        stats->dir_bytes += ent->size;
+    }
+}
+
+static void print_tree_done(const char* path, void* ctx) {
+    (void)path;
+    fat_tree_stats_t* stats = ctx;
+    printf("  total %d\n", (int)(stats->dir_bytes / 1024));
+    printf("  %d files and directories\n", stats->dir_count);
+}
+
+int fat_walk_print_tree(fat_volume_t* vol) {
+    fat_tree_stats_t stats = {0};
+    const fat_walk_visitor_t visitor = {
+        .enter_dir = print_tree_enter,
+        .entry = print_tree_entry,
+        .dir_done = print_tree_done,
+        .leave_dir = NULL,
+    };
+
+    int result = fat_walk(vol, &visitor, &stats);
+
+    printf("\n  %u directories, %u files, %llu bytes\n",
+           stats.dirs, stats.files, (unsigned long long)stats.bytes);
+    fat_volume_print_cache_stats(vol);
+
+    if (result < 0) {
+        printf("  Walk finished with errors (%d)\n", result);
+    }
+    return result;
+}
@@ -0,0 +1,56 @@
+#ifndef FAT_WALK_H
+#define FAT_WALK_H
+
+#include "pico/stdlib.h"
+#include "fat_volume.h"
+#include "fat_dir.h"
+
+// Walker limits: memory is O(depth), independent of the number of files
+#define FAT_WALK_MAX_DEPTH 16
+#define FAT_WALK_BATCH     16
+#define FAT_WALK_PATH_MAX  256
+
+// Callbacks invoked during a walk; any of them may be NULL.
+// enter_dir is called before a directory's entries, dir_done after them,
+// leave_dir after the directory's whole subtree (post-order). The first
+// cluster passed to enter_dir is 0 for the root directory. filter sees
+// each raw 8.3 entry first; entries it rejects are never decoded or
+// reported, but directories are always passed so the walk can descend.
+// include_deleted also reports 0xE5 entries and descends into deleted
+// directories whose first cluster is still free and still starts with
+// their own "." entry; only that first cluster is read, as the rest of
+// the chain is gone.
+typedef struct {
+    void (*enter_dir)(const char* path, uint32_t first_cluster, uint32_t depth, void* ctx);
+    void (*entry)(const char* path, const fat_dirent_t* ent, void* ctx);
+    void (*dir_done)(const char* path, void* ctx);
+    void (*leave_dir)(const char* path, void* ctx);
+    bool (*filter)(const uint8_t* entry, void* ctx);
+    bool include_deleted;
+} fat_walk_visitor_t;
+
+// Subdirectory waiting to be visited, re-read by index when descended into
+typedef struct {
+    uint32_t cluster;
+    uint32_t set_index;
+    bool deleted;               // Deleted entry, or anything below one
+} fat_walk_child_t;
+
+// One level of the explicit walk stack
+typedef struct {
+    uint32_t first_cluster;
+    uint32_t scan_index;        // Where the next batch of subdirectories starts
+    uint16_t path_len;
+    uint8_t child_count;
+    uint8_t next_child;
+    bool scan_done;
+    bool deleted;               // Only the first cluster can be read
+    fat_walk_child_t children[FAT_WALK_BATCH];
+} fat_walk_frame_t;
+
+int fat_walk(fat_volume_t* vol, const fat_walk_visitor_t* visitor, void* ctx);
+
+// Recursive 'ls -lR' style listing of a whole volume
+int fat_walk_print_tree(fat_volume_t* vol);
+
+#endif // FAT_WALK_H
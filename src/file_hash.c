@@ -0,0 +1,271 @@
+#include "file_hash.h"
+#include "crc32.h"
+#include "fat_file.h"
+#include "fat_walk.h"
+#include "exfat_file.h"
+#include "exfat_walk.h"
+#include <stdio.h>
+#include <string.h>
+
+#if FILE_HASH_USE_CORE1
+#include "pico/multicore.h"
+#endif
+
+// Double buffer: core0 fills one while the other is being hashed
+static uint8_t hash_buffers[2][FILE_HASH_BUFFER_BYTES] __attribute__((aligned(4)));
+static volatile uint32_t hash_lengths[2];
+static uint32_t hash_crc;
+static sha256_ctx_t hash_sha;
+
+static void file_hash_consume(uint32_t index) {
+    hash_crc = crc32_update(hash_crc, hash_buffers[index], hash_lengths[index]);
+    sha256_update(&hash_sha, hash_buffers[index], hash_lengths[index]);
+}
+
+#if FILE_HASH_USE_CORE1
+static bool core1_running = false;
+
+// Core1 hashes whichever buffer index it is handed and hands it back
+static void file_hash_core1_entry(void) {
+    for (;;) {
+        uint32_t index = multicore_fifo_pop_blocking();
+        file_hash_consume(index);
+        multicore_fifo_push_blocking(index);
+    }
+}
+
+static void file_hash_submit(uint32_t index) {
+    if (!core1_running) {
+        multicore_launch_core1(file_hash_core1_entry);
+        core1_running = true;
+    }
+    multicore_fifo_push_blocking(index);
+}
+
+static void file_hash_wait(void) {
+    multicore_fifo_pop_blocking();
+}
+#else
+static void file_hash_submit(uint32_t index) {
+    file_hash_consume(index);
+}
+
+static void file_hash_wait(void) {
+}
+#endif
+
+int file_hash_stream(file_hash_read_fn read, void* file, uint64_t size, file_hash_t* hash) {
+    uint64_t offset = 0;
+    uint32_t index = 0;
+    bool busy = false;
+    int result = 0;
+
+    hash_crc = CRC32_INIT;
+    sha256_init(&hash_sha);
+
+    while (offset < size) {
+        // The buffer being filled was released before the previous submit
+        int32_t got = read(file, offset, hash_buffers[index], FILE_HASH_BUFFER_BYTES);
+        if (got <= 0) {
+            result = (got < 0) ? got : -5; // Short read
+            break;
+        }
+
+        if (busy) file_hash_wait();
+        hash_lengths[index] = (uint32_t)got;
+        file_hash_submit(index);
+        busy = true;
+
+        offset += (uint32_t)got;
+        index ^= 1;
+    }
+
+    if (busy) file_hash_wait();
+    if (result != 0) {
+        return result;
+    }
+
+    hash->crc32 = crc32_final(hash_crc);
+    sha256_final(&hash_sha, hash->sha256);
+    hash->size = size;
+    return 0;
+}
+
+void file_hash_print(const file_hash_t* hash, const char* path) {
+    printf("  %08x  ", hash->crc32);
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        printf("%02x", hash->sha256[i]);
+    }
+    printf("  %10llu  %s\n", (unsigned long long)hash->size, path);
+}
+
+static int32_t file_hash_fat_read(void* file, uint64_t offset, uint8_t* buffer, uint32_t len) {
+    return fat_file_read((fat_file_t*)file, (uint32_t)offset, buffer, len);
+}
+
+static fat_file_t hash_file;
+
+int file_hash_fat_path(fat_volume_t* vol, const char* path) {
+    file_hash_t hash;
+
+    int result = fat_file_open_path(&hash_file, vol, path);
+    if (result == 0) {
+        result = file_hash_stream(file_hash_fat_read, &hash_file, hash_file.size, &hash);
+    }
+
+    if (result != 0) {
+        printf("  Cannot hash %s (error %d)\n", path, result);
+        return result;
+    }
+
+    file_hash_print(&hash, path);
+    return 0;
+}
+
+typedef struct {
+    fat_volume_t* vol;
+    uint32_t files;
+    uint32_t errors;
+    uint64_t bytes;
+} file_hash_tree_t;
+
+static void file_hash_tree_entry(const char* dir_path, const fat_dirent_t* ent, void* ctx) {
+    file_hash_tree_t* tree = ctx;
+    static char path[FAT_WALK_PATH_MAX + FAT_DIR_NAME_MAX]; // Kept off core0's stack
+    file_hash_t hash;
+
+    if (ent->attributes & FAT_ATTR_DIRECTORY) {
+        return;
+    }
+
+    snprintf(path, sizeof(path), "%s%s%s",
+             dir_path, strcmp(dir_path, "/") == 0 ? "" : "/", ent->name);
+
+    int result = fat_file_open_entry(&hash_file, tree->vol, ent);
+    if (result == 0) {
+        result = file_hash_stream(file_hash_fat_read, &hash_file, hash_file.size, &hash);
+    }
+
+    if (result != 0) {
+        printf("  Cannot hash %s (error %d)\n", path, result);
+        tree->errors++;
+        return;
+    }
+
+    file_hash_print(&hash, path);
+    tree->files++;
+    tree->bytes += ent->size;
+}
+
+int file_hash_fat_tree(fat_volume_t* vol) {
+    file_hash_tree_t tree = {vol, 0, 0, 0};
+    const fat_walk_visitor_t visitor = {
+        .enter_dir = NULL,
+        .entry = file_hash_tree_entry,
+        .dir_done = NULL,
+        .leave_dir = NULL,
+    };
+
+    printf("\n  === File hashes (CRC32, SHA-256) ===\n");
+    uint64_t start_us = time_us_64();
+    int result = fat_walk(vol, &visitor, &tree);
+    uint32_t elapsed_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+
+    printf("  %u files, %llu bytes hashed in %u ms", tree.files,
+           (unsigned long long)tree.bytes, elapsed_ms);
+    if (elapsed_ms > 0) {
+        printf(" (%u KB/s)", (uint32_t)(tree.bytes / elapsed_ms * 1000 / 1024));
+    }
+    printf("\n");
+
+    if (tree.errors > 0) {
+        printf("  %u files could not be hashed\n", tree.errors);
+    }
+    return result;
+}
+
+static int32_t file_hash_exfat_read(void* file, uint64_t offset, uint8_t* buffer, uint32_t len) {
+    return exfat_file_read((exfat_file_t*)file, offset, buffer, len);
+}
+
+static exfat_file_t hash_exfat_file;
+
+int file_hash_exfat_path(exfat_volume_t* vol, const char* path) {
+    file_hash_t hash;
+
+    int result = exfat_file_open_path(&hash_exfat_file, vol, path);
+    if (result == 0) {
+        result = file_hash_stream(file_hash_exfat_read, &hash_exfat_file, hash_exfat_file.size, &hash);
+    }
+
+    if (result != 0) {
+        printf("  Cannot hash %s (error %d)\n", path, result);
+        return result;
+    }
+
+    file_hash_print(&hash, path);
+    return 0;
+}
+
+typedef struct {
+    exfat_volume_t* vol;
+    uint32_t files;
+    uint32_t contiguous;
+    uint32_t errors;
+    uint64_t bytes;
+} file_hash_exfat_tree_t;
+
+static void file_hash_exfat_entry(const char* dir_path, const exfat_dirent_t* ent, void* ctx) {
+    file_hash_exfat_tree_t* tree = ctx;
+    static char path[EXFAT_WALK_PATH_MAX + EXFAT_NAME_MAX]; // Kept off core0's stack
+    file_hash_t hash;
+
+    if (ent->attributes & FAT_ATTR_DIRECTORY) {
+        return;
+    }
+
+    snprintf(path, sizeof(path), "%s%s%s",
+             dir_path, strcmp(dir_path, "/") == 0 ? "" : "/", ent->name);
+
+    int result = exfat_file_open_entry(&hash_exfat_file, tree->vol, ent);
+    if (result == 0) {
+        result = file_hash_stream(file_hash_exfat_read, &hash_exfat_file, hash_exfat_file.size, &hash);
+    }
+
+    if (result != 0) {
+        printf("  Cannot hash %s (error %d)\n", path, result);
+        tree->errors++;
+        return;
+    }
+
+    file_hash_print(&hash, path);
+    tree->files++;
+    tree->bytes += ent->data_length;
+    if (hash_exfat_file.contiguous) tree->contiguous++;
+}
+
+int file_hash_exfat_tree(exfat_volume_t* vol) {
+    file_hash_exfat_tree_t tree = {vol, 0, 0, 0, 0};
+    const exfat_walk_visitor_t visitor = {
+        .enter_dir = NULL,
+        .entry = file_hash_exfat_entry,
+        .dir_done = NULL,
+    };
+
+    printf("\n  === File hashes (CRC32, SHA-256) ===\n");
+    uint64_t start_us = time_us_64();
+    int result = exfat_walk(vol, &visitor, &tree);
+    uint32_t elapsed_ms = (uint32_t)((time_us_64() - start_us) / 1000);
+
+    printf("  %u files (%u contiguous), %llu bytes hashed in %u ms", tree.files, tree.contiguous,
+           (unsigned long long)tree.bytes, elapsed_ms);
+    if (elapsed_ms > 0) {
+        printf(" (%u KB/s)", (uint32_t)(tree.bytes / elapsed_ms * 1000 / 1024));
+    }
+    printf("\n");
+
+    if (tree.errors > 0) {
+        printf("  %u files could not be hashed\n", tree.errors);
+    }
+    return result;
+}
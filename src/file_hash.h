@@ -0,0 +1,37 @@
+#ifndef FILE_HASH_H
+#define FILE_HASH_H
+
+#include "pico/stdlib.h"
+#include "sha256.h"
+#include "fat_volume.h"
+#include "exfat_volume.h"
+
+// Bytes per read buffer; two buffers alternate between SD reads and hashing
+#define FILE_HASH_BUFFER_BYTES 8192
+
+// Hash on core1 so that it overlaps the next SD transfer on core0
+#ifndef FILE_HASH_USE_CORE1
+#define FILE_HASH_USE_CORE1 1
+#endif
+
+typedef struct {
+    uint32_t crc32;
+    uint8_t sha256[SHA256_DIGEST_SIZE];
+    uint64_t size;
+} file_hash_t;
+
+// Reads up to len bytes at offset from an open file; returns bytes read
+typedef int32_t (*file_hash_read_fn)(void* file, uint64_t offset, uint8_t* buffer, uint32_t len);
+
+int file_hash_stream(file_hash_read_fn read, void* file, uint64_t size, file_hash_t* hash);
+void file_hash_print(const file_hash_t* hash, const char* path);
+
+// FAT commands: one file by path, or every file on the volume
+int file_hash_fat_path(fat_volume_t* vol, const char* path);
+int file_hash_fat_tree(fat_volume_t* vol);
+
+// exFAT: one file by path, or every file on the volume
+int file_hash_exfat_path(exfat_volume_t* vol, const char* path);
+int file_hash_exfat_tree(exfat_volume_t* vol);
+
+#endif // FILE_HASH_H
@@ -4,9 +4,87 @@
 #include "pico/stdlib.h"
 #include "sd_analyzer.h"
 #include "partition_display.h"
+#include "fat_volume.h"
+#include "fat_walk.h"
+#include "fat_space.h"
+#include "fat_frag.h"
+#include "file_hash.h"
+#include "fat_undelete.h"
+#include "fat_check.h"
+#include "fat_path.h"
+#include "fat_sort.h"
+#include "fat_du.h"
+#include "fat_find.h"
+#include "fat_format.h"
+#include "fat_map.h"
+#include "exfat_volume.h"
+#include "exfat_walk.h"
+#include "exfat_space.h"
+#include "exfat_path.h"
+#include "ext_volume.h"
+#include "ext_inode.h"
+#include "ext_dir.h"
+#include "ext_path.h"
 
 #define VERSION "1.6.0"
 
+// Recount FAT32 free space from the FAT and check it against FSInfo
+#define VERIFY_FREE_SPACE 0
+
+// Print CRC32 and SHA-256 of every file on each FAT and exFAT volume
+#define HASH_FILES 0
+
+// Print CRC32 and SHA-256 of the files in lookup_paths on each FAT and exFAT volume
+#define HASH_LOOKUP_PATHS 0
+
+// List deleted entries and rate how recoverable their data is
+#define SCAN_DELETED 0
+
+// Compare the FAT copies, run the read-only consistency check and print a
+// verdict. Slow on large cards: each pass re-walks the whole tree and covers
+// FAT_CHECK_BITMAP_BYTES * 8 clusters, up to FAT_CHECK_MAX_PASSES
+#define CHECK_FAT 0
+
+// Per-directory logical and on-disk sizes, largest directories first
+#define DISK_USAGE 0
+
+// Directory listed in sorted order on each FAT volume (NULL to skip)
+#define SORTED_LIST_PATH NULL
+#define SORTED_LIST_ORDER FAT_SORT_SIZE
+
+// Files searched for by name on each FAT volume (NULL to skip), e.g. "*.log"
+#define FIND_NAME_GLOB NULL
+
+// Map of used, free and bad cluster regions per FAT volume, after the partition table
+#define ALLOCATION_MAP 1
+
+// Lay out an AU-aligned FAT filesystem before analysing; without
+// FORMAT_CONFIRM only the plan is printed and nothing is written
+#define FORMAT_CARD 0
+#define FORMAT_CONFIRM 0
+#define FORMAT_LABEL "SDCARD"
+
+// Directory listed on each ext volume (NULL to skip), e.g. "/etc"
+#define EXT_LIST_PATH "/"
+
+// Text file printed from each ext volume (NULL to skip), e.g. "/etc/fstab"
+#define EXT_CAT_PATH NULL
+#define EXT_CAT_MAX_BYTES 4096
+
+// Paths resolved and listed on each FAT, exFAT and ext volume, e.g. "/DCIM/100CANON/IMG_0001.JPG"
+static const char* const lookup_paths[] = {
+    NULL
+};
+
+// Mounted FAT volume, kept off the stack for its FAT window
+static fat_volume_t fat_volume;
+static fat_frag_report_t frag_report;
+static fat_du_report_t du_report;
+static fat_map_t alloc_map;
+static exfat_volume_t exfat_volume;
+static ext_volume_t ext_volume;
+static ext_groups_report_t ext_groups;
+
 int main() {
     stdio_init_all();
     
@@ -22,6 +100,10 @@ int main() {
     }
     
     printf("\nSD card initialized successfully!\n");
+    
+    if (FORMAT_CARD) {
+        fat_format_card(FORMAT_LABEL, FORMAT_CONFIRM);
+    }
     printf("\nAnalyzing SD card content...\n");
     
     // Get SD card analysis
@@ -70,6 +152,20 @@ int main() {
         printf("Partition table: None\n");
     }
     
+    if (ALLOCATION_MAP) {
+        for (int i = 0; i < partition_count; i++) {
+            if (strncmp(enhanced_partitions[i].filesystem, "FAT", 3) != 0 ||
+                fat_volume_mount(&fat_volume, enhanced_partitions[i].start_lba) != 0) {
+                continue;
+            }
+            
+            if (fat_map_build(&fat_volume, &alloc_map) == 0) {
+                printf("\nPartition %d:", i + 1);
+                fat_map_print(&fat_volume, &alloc_map);
+            }
+        }
+    }
+    
     if (partition_count > 0) {
         // Show contents of ALL partitions
         printf("\n=== ALL PARTITION CONTENTS ===\n");
@@ -93,29 +189,152 @@ int main() {
                 strcmp(enhanced_partitions[i].filesystem, "FAT16") == 0 ||
                 strcmp(enhanced_partitions[i].filesystem, "FAT12") == 0) {
                 
-                // Calculate actual root directory location for FAT
-                uint32_t fat_start_lba = enhanced_partitions[i].start_lba;
-                
-                // Read the boot sector to get proper FAT parameters
-                uint8_t boot_sector[512];
-                if (sd_read_block(fat_start_lba, boot_sector) == 0) {
-                    // Parse FAT boot sector to find root directory
-                    uint16_t reserved_sectors = *(uint16_t*)(boot_sector + 14);
-                    uint8_t num_fats = boot_sector[16];
-                    uint32_t fat_size = *(uint32_t*)(boot_sector + 36); // FAT32
-                    
-                    uint32_t root_dir_lba = fat_start_lba + reserved_sectors + (num_fats * fat_size);
-                    
-                    printf("Root directory at LBA %u:\n", root_dir_lba);
-                    sd_analyzer_list_fat_directory(root_dir_lba, "/");
+                // Mount the volume to get proper FAT parameters
+                if (fat_volume_mount(&fat_volume, enhanced_partitions[i].start_lba) == 0) {
+                    // Recursive listing of the whole volume
+                    fat_walk_print_tree(&fat_volume);
+                    
+                    // FAT32 FSInfo gives instant numbers; count the FAT only
+                    // when there is none or verification was asked for
+                    fat_fsinfo_t fsinfo;
+                    bool have_fsinfo = fat_volume_read_fsinfo(&fat_volume, &fsinfo) == 0;
+                    if (have_fsinfo) {
+                        fat_space_print_fsinfo(&fat_volume, &fsinfo);
+                    }
+                    
+                    if (!have_fsinfo || VERIFY_FREE_SPACE) {
+                        fat_space_t space;
+                        if (fat_space_count(&fat_volume, &space) == 0) {
+                            fat_space_print(&space);
+                            if (have_fsinfo) {
+                                fat_space_verify_fsinfo(&fat_volume, &fsinfo, &space);
+                            }
+                        }
+                    }
+                    
+                    if (fat_frag_analyze(&fat_volume, &frag_report) == 0) {
+                        fat_frag_print(&fat_volume, &frag_report);
+                    }
+                    
+                    if (HASH_FILES) {
+                        file_hash_fat_tree(&fat_volume);
+                    }
+                    
+                    if (DISK_USAGE && fat_du_analyze(&fat_volume, &du_report) == 0) {
+                        fat_du_print(&du_report);
+                    }
+                    
+                    if (SORTED_LIST_PATH != NULL) {
+                        fat_sort_list(&fat_volume, SORTED_LIST_PATH, SORTED_LIST_ORDER);
+                    }
+                    
+                    if (FIND_NAME_GLOB != NULL) {
+                        fat_find_query_t query;
+                        fat_find_stats_t find_stats;
+                        fat_find_query_init(&query);
+                        query.name_glob = FIND_NAME_GLOB;
+                        query.attr_clear = FAT_ATTR_DIRECTORY;
+                        fat_find(&fat_volume, &query, &find_stats);
+                    }
+                    
+                    if (lookup_paths[0] != NULL) {
+                        printf("\n  === Path lookups ===\n");
+                        for (int p = 0; lookup_paths[p] != NULL; p++) {
+                            fat_path_print(&fat_volume, lookup_paths[p]);
+                        }
+                        fat_path_print_cache_stats();
+                        
+                        if (HASH_LOOKUP_PATHS) {
+                            printf("\n  === File hashes (CRC32, SHA-256) ===\n");
+                            for (int p = 0; lookup_paths[p] != NULL; p++) {
+                                file_hash_fat_path(&fat_volume, lookup_paths[p]);
+                            }
+                        }
+                    }
+                    
+                    if (CHECK_FAT) {
+                        fat_check_copies_t copies;
+                        fat_check_compare_copies(&fat_volume, &copies);
+                        
+                        fat_check_report_t check_report;
+                        int check_result = fat_check_volume(&fat_volume, &check_report);
+                        if (check_result == 0) {
+                            fat_check_print(&check_report);
+                        } else {
+                            printf("  Consistency check failed (error %d)\n", check_result);
+                        }
+                    }
+                    
+                    if (SCAN_DELETED) {
+                        fat_undelete_report_t undelete_report;
+                        fat_undelete_scan(&fat_volume, &undelete_report);
+                        fat_undelete_print(&undelete_report);
+                    }
                 } else {
-                    printf("Could not read boot sector for partition %d\n", i + 1);
+                    printf("Could not mount FAT volume on partition %d\n", i + 1);
                 }
                 
             } else if (strcmp(enhanced_partitions[i].filesystem, "exFAT") == 0) {
-                printf("exFAT partition - detailed analysis not implemented yet\n");
+                if (exfat_volume_mount(&exfat_volume, enhanced_partitions[i].start_lba) == 0) {
+                    exfat_volume_print_info(&exfat_volume);
+                    
+                    fat_space_t space;
+                    if (exfat_space_count(&exfat_volume, &space) == 0) {
+                        exfat_space_print(&exfat_volume, &space);
+                    }
+                    exfat_walk_print_tree(&exfat_volume);
+                    
+                    if (lookup_paths[0] != NULL) {
+                        printf("\n  === Path lookups ===\n");
+                        exfat_path_reset_stats();
+                        for (int p = 0; lookup_paths[p] != NULL; p++) {
+                            exfat_path_print(&exfat_volume, lookup_paths[p]);
+                        }
+                        exfat_path_print_stats();
+                        
+                        if (HASH_LOOKUP_PATHS) {
+                            printf("\n  === File hashes (CRC32, SHA-256) ===\n");
+                            for (int p = 0; lookup_paths[p] != NULL; p++) {
+                                file_hash_exfat_path(&exfat_volume, lookup_paths[p]);
+                            }
+                        }
+                    }
+                    
+                    if (HASH_FILES) {
+                        file_hash_exfat_tree(&exfat_volume);
+                    }
+                } else {
+                    printf("Could not mount exFAT volume on partition %d\n", i + 1);
+                }
             } else if (strncmp(enhanced_partitions[i].filesystem, "ext", 3) == 0) {
-                printf("Linux ext filesystem - detailed analysis not implemented yet\n");
+                if (ext_volume_mount(&ext_volume, enhanced_partitions[i].start_lba) == 0) {
+                    ext_volume_print_info(&ext_volume);
+                    
+                    if (ext_volume_scan_groups(&ext_volume, &ext_groups) == 0) {
+                        ext_volume_print_groups(&ext_volume, &ext_groups);
+                    }
+                    
+                    ext_inode_cache_reset();
+                    if (EXT_LIST_PATH != NULL) {
+                        ext_path_list(&ext_volume, EXT_LIST_PATH);
+                    }
+                    
+                    if (lookup_paths[0] != NULL) {
+                        printf("\n  === Path lookups ===\n");
+                        ext_dir_reset_stats();
+                        for (int p = 0; lookup_paths[p] != NULL; p++) {
+                            ext_path_print(&ext_volume, lookup_paths[p]);
+                        }
+                        ext_dir_print_stats();
+                    }
+                    
+                    if (EXT_CAT_PATH != NULL) {
+                        ext_path_cat(&ext_volume, EXT_CAT_PATH, EXT_CAT_MAX_BYTES);
+                    }
+                    ext_inode_print_cache_stats();
+                } else {
+                    printf("Could not mount ext volume on partition %d\n", i + 1);
+                }
             } else {
                 printf("Unknown filesystem type - cannot analyze contents\n");
             }
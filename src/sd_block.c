@@ -0,0 +1,268 @@
+#include "sd_block.h"
+#include "sd_analyzer.h"
+#include "hardware/gpio.h"
+#include <stdio.h>
+
+#define CMD9                 (0x40 | 9)
+#define STOP_TRANSMISSION    (0x40 | 12)
+#define CMD13                (0x40 | 13)
+#define READ_MULTIPLE_BLOCK  (0x40 | 18)
+#define WRITE_BLOCK          (0x40 | 24)
+#define WRITE_MULTIPLE_BLOCK (0x40 | 25)
+
+static void sd_block_select(void) {
+    gpio_put(SD_PIN_CS, 0);
+}
+
+static void sd_block_deselect(void) {
+    gpio_put(SD_PIN_CS, 1);
+}
+
+static uint8_t sd_block_spi_write(uint8_t data) {
+    uint8_t rx_data;
+    spi_write_read_blocking(SD_SPI_PORT, &data, &rx_data, 1);
+    return rx_data;
+}
+
+static void sd_block_wait_not_busy(void) {
+    while (sd_block_spi_write(0xFF) != 0xFF);
+}
+
+static uint8_t sd_block_command(uint8_t cmd, uint32_t arg) {
+    uint8_t response = 0xFF;
+
+    sd_block_wait_not_busy();
+
+    sd_block_spi_write(cmd);
+    sd_block_spi_write((arg >> 24) & 0xFF);
+    sd_block_spi_write((arg >> 16) & 0xFF);
+    sd_block_spi_write((arg >> 8) & 0xFF);
+    sd_block_spi_write(arg & 0xFF);
+    sd_block_spi_write(0x01); // CRC is ignored once the card is in SPI mode
+
+    for (int i = 0; i < 10; i++) {
+        response = sd_block_spi_write(0xFF);
+        if ((response & 0x80) == 0) break;
+    }
+    return response;
+}
+
+// Wait for the start token of a data block; returns 0 when it arrived
+static int sd_block_wait_token(void) {
+    int timeout = 1000;
+    uint8_t response;
+    do {
+        response = sd_block_spi_write(0xFF);
+        timeout--;
+    } while (response != 0xFE && timeout > 0);
+
+    return (response == 0xFE) ? 0 : -1;
+}
+
+// SDHC/SDXC cards are block addressed, older cards byte addressed
+static uint32_t sd_block_address(uint32_t block) {
+    sd_card_info_t info;
+    sd_get_info(&info);
+    return (info.type == SD_CARD_TYPE_SDHC) ? block : block * 512;
+}
+
+// CMD12 is sent while the card is still streaming data, so it skips the
+// busy wait before the command and the stuff byte after it
+static uint8_t sd_block_stop_transmission(void) {
+    uint8_t response = 0xFF;
+
+    sd_block_spi_write(STOP_TRANSMISSION);
+    sd_block_spi_write(0x00);
+    sd_block_spi_write(0x00);
+    sd_block_spi_write(0x00);
+    sd_block_spi_write(0x00);
+    sd_block_spi_write(0x01);
+
+    // Stuff byte
+    sd_block_spi_write(0xFF);
+
+    for (int i = 0; i < 10; i++) {
+        response = sd_block_spi_write(0xFF);
+        if ((response & 0x80) == 0) break;
+    }
+
+    sd_block_wait_not_busy();
+    return response;
+}
+
+int sd_read_blocks(uint32_t block, uint32_t count, uint8_t *buffer) {
+    if (count == 0) return 0;
+    if (count == 1) return sd_read_block(block, buffer);
+
+    sd_block_select();
+
+    uint8_t response = sd_block_command(READ_MULTIPLE_BLOCK, sd_block_address(block));
+    if (response != 0x00) {
+        printf("CMD18 failed with response: 0x%02X\n", response);
+        sd_block_deselect();
+        return -1;
+    }
+
+    for (uint32_t n = 0; n < count; n++) {
+        if (sd_block_wait_token() != 0) {
+            sd_block_stop_transmission();
+            sd_block_deselect();
+            return -1;
+        }
+
+        // Read the whole block in one SPI transfer
+        spi_read_blocking(SD_SPI_PORT, 0xFF, buffer + n * 512, 512);
+
+        // Read CRC (ignore)
+        sd_block_spi_write(0xFF);
+        sd_block_spi_write(0xFF);
+    }
+
+    sd_block_stop_transmission();
+    sd_block_deselect();
+    return 0;
+}
+
+// Read a register sent as a data block after an R1 response (CSD, CID)
+static int sd_block_read_register(uint8_t cmd, uint8_t *data, uint32_t length) {
+    sd_block_select();
+
+    if (sd_block_command(cmd, 0) != 0x00 || sd_block_wait_token() != 0) {
+        sd_block_deselect();
+        return -1;
+    }
+
+    spi_read_blocking(SD_SPI_PORT, 0xFF, data, length);
+
+    // Read CRC (ignore)
+    sd_block_spi_write(0xFF);
+    sd_block_spi_write(0xFF);
+
+    sd_block_deselect();
+    return 0;
+}
+
+int sd_read_capacity(uint32_t *blocks) {
+    uint8_t csd[16];
+
+    if (sd_block_read_register(CMD9, csd, sizeof(csd)) != 0) {
+        return -1;
+    }
+
+    switch (csd[0] >> 6) {
+        case 0: {
+            // CSD 1.0: (C_SIZE + 1) << (C_SIZE_MULT + 2) blocks of 2^READ_BL_LEN
+            // bytes, where READ_BL_LEN is 9, 10 or 11
+            uint32_t c_size = ((csd[6] & 0x03) << 10) | (csd[7] << 2) | (csd[8] >> 6);
+            uint32_t c_size_mult = ((csd[9] & 0x03) << 1) | (csd[10] >> 7);
+            uint32_t read_bl_len = csd[5] & 0x0F;
+            if (read_bl_len < 9 || read_bl_len > 11) {
+                return -1;
+            }
+            *blocks = ((c_size + 1) << (c_size_mult + 2)) << (read_bl_len - 9);
+            return 0;
+        }
+        case 1: {
+            // CSD 2.0: capacity is (C_SIZE + 1) * 512 KB
+            uint32_t c_size = ((uint32_t)(csd[7] & 0x3F) << 16) | (csd[8] << 8) | csd[9];
+            *blocks = (c_size + 1) * 1024;
+            return 0;
+        }
+        default:
+            return -1; // CSD 3.0 (SDUC) does not fit 32-bit block numbers
+    }
+}
+
+// ACMD13 returns the 512-bit SD Status after an R2 response (R1 plus a
+// second status byte)
+int sd_read_sd_status(uint8_t *status) {
+    sd_block_select();
+
+    uint8_t response = sd_block_command(CMD55, 0);
+    if (response > 0x01) {
+        sd_block_deselect();
+        return -1;
+    }
+
+    response = sd_block_command(CMD13, 0);
+    sd_block_spi_write(0xFF);
+    if (response != 0x00 || sd_block_wait_token() != 0) {
+        printf("ACMD13 failed with response: 0x%02X\n", response);
+        sd_block_deselect();
+        return -1;
+    }
+
+    spi_read_blocking(SD_SPI_PORT, 0xFF, status, SD_STATUS_SIZE);
+
+    // Read CRC (ignore)
+    sd_block_spi_write(0xFF);
+    sd_block_spi_write(0xFF);
+
+    sd_block_deselect();
+    return 0;
+}
+
+// Send one data block with the given start token and check the card's
+// data response; the card is busy programming until it releases MISO
+static int sd_block_send_data(uint8_t token, const uint8_t *buffer) {
+    sd_block_spi_write(token);
+    spi_write_blocking(SD_SPI_PORT, buffer, 512);
+
+    // Dummy CRC
+    sd_block_spi_write(0xFF);
+    sd_block_spi_write(0xFF);
+
+    uint8_t response = sd_block_spi_write(0xFF);
+    if ((response & 0x1F) != 0x05) {
+        printf("Write rejected with data response: 0x%02X\n", response);
+        return -1;
+    }
+
+    sd_block_wait_not_busy();
+    return 0;
+}
+
+int sd_write_block(uint32_t block, const uint8_t *buffer) {
+    sd_block_select();
+
+    uint8_t response = sd_block_command(WRITE_BLOCK, sd_block_address(block));
+    if (response != 0x00) {
+        printf("CMD24 failed with response: 0x%02X\n", response);
+        sd_block_deselect();
+        return -1;
+    }
+
+    sd_block_spi_write(0xFF);
+    int result = sd_block_send_data(0xFE, buffer);
+
+    sd_block_deselect();
+    return result;
+}
+
+int sd_write_blocks(uint32_t block, uint32_t count, const uint8_t *buffer) {
+    if (count == 0) return 0;
+    if (count == 1) return sd_write_block(block, buffer);
+
+    sd_block_select();
+
+    uint8_t response = sd_block_command(WRITE_MULTIPLE_BLOCK, sd_block_address(block));
+    if (response != 0x00) {
+        printf("CMD25 failed with response: 0x%02X\n", response);
+        sd_block_deselect();
+        return -1;
+    }
+
+    sd_block_spi_write(0xFF);
+    int result = 0;
+    for (uint32_t n = 0; n < count && result == 0; n++) {
+        result = sd_block_send_data(0xFC, buffer + n * 512);
+    }
+
+    // Stop Tran token ends the transfer, then wait out the final programming
+    sd_block_spi_write(0xFD);
+    sd_block_spi_write(0xFF);
+    sd_block_wait_not_busy();
+
+    sd_block_deselect();
+    return result;
+}
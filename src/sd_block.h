@@ -0,0 +1,29 @@
+#ifndef SD_BLOCK_H
+#define SD_BLOCK_H
+
+#include "pico/stdlib.h"
+#include "sd_card.h"
+
+// Multi-block transfers, writes and register reads for the card
+// pico-sd-lib has initialised. They drive the same SPI bus and chip select
+// as sd_init() and take block numbers in 512-byte sectors, like
+// sd_read_block().
+
+// Size of the SD Status register returned by ACMD13
+#define SD_STATUS_SIZE 64
+
+// Read count consecutive blocks with one CMD18; returns 0 or -1
+int sd_read_blocks(uint32_t block, uint32_t count, uint8_t *buffer);
+
+// Write one block with CMD24, or count blocks with one CMD25; returns 0 or -1
+int sd_write_block(uint32_t block, const uint8_t *buffer);
+int sd_write_blocks(uint32_t block, uint32_t count, const uint8_t *buffer);
+
+// Read the SD Status register (ACMD13), which holds the allocation unit size
+int sd_read_sd_status(uint8_t *status);
+
+// Card capacity in 512-byte blocks from the CSD (CMD9); returns -1 when the
+// CSD cannot be read or describes a layout this driver does not know
+int sd_read_capacity(uint32_t *blocks);
+
+#endif // SD_BLOCK_H
@@ -0,0 +1,19 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include "pico/stdlib.h"
+
+#define SHA256_DIGEST_SIZE 32
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;            // Bytes hashed so far
+    uint8_t block[64];
+    uint32_t block_len;
+} sha256_ctx_t;
+
+void sha256_init(sha256_ctx_t* ctx);
+void sha256_update(sha256_ctx_t* ctx, const uint8_t* data, size_t len);
+void sha256_final(sha256_ctx_t* ctx, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+#endif // SHA256_H